@@ -0,0 +1,333 @@
+#include "acq.h"
+#include "timebase.h"
+#include "pool.h"
+#include "route.h"
+#include "ring.h"
+#include "prof.h"
+
+#include "dispatcher.h"
+
+
+#include "utils/pt.h"
+#include "utils/fifo.h"
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+// the accelerometer is a MPU6050 on the I2C bus
+//
+// the sensor stores its samples in its own fifo at the sampling rate
+// and the fifo is periodically read in bursts throught the dispatcher I2C frames
+// the I2C transfers are interrupt driven so the main loop is never blocked
+//
+// a burst fills a bank of samples while the previous one is filtered
+
+// ------------------------------------------
+// private definitions
+//
+
+#define IN_FIFO_SIZE    1
+#define EV_RING_SIZE    2
+
+#define ACQ_EV_BURST    0x01
+
+#define MPU_ADDR                0x68
+#define MPU_SMPLRT_DIV          0x19
+#define MPU_CONFIG              0x1a
+#define MPU_ACCEL_CONFIG        0x1c
+#define MPU_FIFO_EN             0x23
+#define MPU_USER_CTRL           0x6a
+#define MPU_PWR_MGMT_1          0x6b
+#define MPU_FIFO_COUNTH         0x72
+#define MPU_FIFO_R_W            0x74
+
+#define MPU_FIFO_RESET          0x44    // USER_CTRL: fifo enabled and flushed
+#define MPU_FIFO_SIZE           1024
+#define MPU_SAMPLE_SIZE         6       // x, y, z accelerations, msb first
+
+#define ACQ_PERIOD      (10 * TMB_1_MSEC)       // bursts period
+#define ACQ_RETRY       (100 * TMB_1_MSEC)      // configuration retry period after a failure
+#define ACQ_BURST       8       // bank size [samples], 5 are expected per burst
+#define ACQ_FILTER      2       // low pass filter shift, cut-off at about 20 Hz
+
+// sensor configuration, register and value
+static const u8 acq_conf[][2] PROGMEM = {
+        { MPU_PWR_MGMT_1, 0x01 },       // wake up, clock on the x gyro pll
+        { MPU_CONFIG, 0x01 },           // 184 Hz bandwidth, 1 kHz internal rate
+        { MPU_SMPLRT_DIV, 0x01 },       // 500 Hz sampling rate
+        { MPU_ACCEL_CONFIG, 0x10 },     // +/- 8 g range
+        { MPU_USER_CTRL, MPU_FIFO_RESET },
+        { MPU_FIFO_EN, 0x08 },          // only the accelerations are stored
+};
+
+
+// ------------------------------------------
+// private variables
+//
+
+struct {
+        pt_t pt;                        // acquisition thread
+        pt_t pt_xfer;                   // I2C transfer thread
+        dpt_interface_t interf;         // interface to the dispatcher
+
+        frame_t in_buf[IN_FIFO_SIZE];   // incoming buffer and fifo for the I2C responses
+        fifo_t in_fifo;
+
+        // current I2C transfer
+        pol_t hd;                       // pool frame of the request
+        frame_t fr;                     // response
+        u8 cmde;                        // FR_I2C_WRITE or FR_I2C_READ
+        u8 len;                         // number of bytes
+        u8 data[DPT_ARGC];              // written or read bytes
+        u8 error;                       // the transfer failed
+
+        tmb_alarm_t alarm;              // bursts alarm
+        ring_t ev;                      // bursts events posted by the timer2 interrupt
+        u8 ev_buf[EV_RING_SIZE];
+        u32 time;                       // next burst time
+
+        u8 i;                           // transfer index in the burst
+        u8 nb;                          // number of samples to read in the burst
+        u8 failed;                      // the sensor shall be configured again
+        u8 on;                          // the accelerations are needed
+
+        // samples double buffer
+        acq_acc_t bank[2][ACQ_BURST];
+        u8 len_bank[2];                 // number of samples in each bank
+        u8 fill;                        // bank filled by the bursts
+
+        s32 filt[3];                    // filter states, 8 bits fractional part
+        acq_acc_t acc;                  // latest filtered acceleration
+        u8 seq;                         // its sequence number
+
+        u8 sending;                     // a frame is waiting for the dispatcher
+} acq;
+
+
+// ------------------------------------------
+// private functions
+//
+
+// prepare the next I2C transfer
+static void acq_set(u8 cmde, u8 len, u8 reg, u8 val)
+{
+        acq.cmde = cmde;
+        acq.len = len;
+        acq.data[0] = reg;
+        acq.data[1] = val;
+}
+
+// run the prepared I2C transfer throught the dispatcher
+static PT_THREAD( acq_xfer(pt_t* pt) )
+{
+        frame_t* fr;
+        u8 i;
+
+        PT_BEGIN(pt);
+
+        PT_WAIT_UNTIL(pt, OK == pol_alloc(&acq.hd, POL_LOW));
+        fr = pol_frame(acq.hd);
+        frame_set_2(fr, MPU_ADDR, DPT_SELF_ADDR, acq.cmde, 0, acq.data[0], acq.data[1]);
+        fr->len = acq.len;
+
+        acq.sending = 1;
+        dpt_lock(&acq.interf);
+        PT_WAIT_UNTIL(pt, OK == prf_try(PRF_Q_ACQ_DPT, rte_tx(&acq.interf, pol_frame(acq.hd))));
+        dpt_unlock(&acq.interf);
+        acq.sending = 0;
+
+        // the frame is copied by the dispatcher
+        // so the pool frame is not held during the transfer
+        pol_free(acq.hd);
+
+        // the frame comes back with the read bytes
+        // only one transfer is in progress so any response is the awaited one
+        do {
+                PT_WAIT_UNTIL(pt, OK == FIFO_get(&acq.in_fifo, &acq.fr));
+        } while (!acq.fr.resp);
+
+        acq.error = acq.fr.error;
+        for (i = 0; i < acq.len; i++)
+                acq.data[i] = acq.fr.argv[i];
+
+        PT_END(pt);
+}
+
+// run an I2C transfer, the sensor is configured again on failure
+#define ACQ_XFER(pt)                                                            \
+        do {                                                                    \
+                PT_SPAWN(pt, &acq.pt_xfer, acq_xfer(&acq.pt_xfer));             \
+                if (acq.error) {                                                \
+                        acq.failed = 1;                                         \
+                        PT_RESTART(pt);                                         \
+                }                                                               \
+        } while (0)
+
+static PT_THREAD( acq_thread(pt_t* pt) )
+{
+        acq_acc_t* acc;
+        u16 count;
+        u8 ev;
+
+        PT_BEGIN(pt);
+
+        // forget a burst of a previous configuration
+        tmb_alarm_cancel(&acq.alarm);
+        while (OK == RING_get(&acq.ev, &ev))
+                ;
+
+        // the sensor is only read while the accelerations are needed
+        // it is configured again each time as its fifo has overflowed meanwhile
+        PT_WAIT_UNTIL(pt, acq.on);
+
+        // after a failure, the sensor is given some time
+        if (acq.failed) {
+                tmb_alarm_set(&acq.alarm, tmb_now_us() + ACQ_RETRY);
+                PT_WAIT_UNTIL(pt, OK == RING_get(&acq.ev, &ev));
+                acq.failed = 0;
+        }
+
+        // configure the sensor
+        for (acq.i = 0; acq.i < sizeof(acq_conf) / sizeof(acq_conf[0]); acq.i++) {
+                acq_set(FR_I2C_WRITE, 2, pgm_read_byte(&acq_conf[acq.i][0]), pgm_read_byte(&acq_conf[acq.i][1]));
+                ACQ_XFER(pt);
+        }
+
+        acq.time = tmb_now_us();
+
+        while (1) {
+                acq.time += ACQ_PERIOD;
+                tmb_alarm_set(&acq.alarm, acq.time);
+                PT_WAIT_UNTIL(pt, !acq.on || OK == RING_get(&acq.ev, &ev));
+
+                // no more burst until enabled again
+                if (!acq.on)
+                        PT_RESTART(pt);
+
+                // number of bytes in the sensor fifo
+                acq_set(FR_I2C_WRITE, 1, MPU_FIFO_COUNTH, 0);
+                ACQ_XFER(pt);
+                acq_set(FR_I2C_READ, 2, 0, 0);
+                ACQ_XFER(pt);
+                count = (acq.data[0] << 8) | acq.data[1];
+
+                // on overflow the fifo content is no more aligned on the samples
+                if (count > MPU_FIFO_SIZE - MPU_SAMPLE_SIZE) {
+                        acq_set(FR_I2C_WRITE, 2, MPU_USER_CTRL, MPU_FIFO_RESET);
+                        ACQ_XFER(pt);
+                        continue;
+                }
+
+                // the samples not fitting in the bank are read by the next burst
+                acq.nb = count / MPU_SAMPLE_SIZE;
+                if (acq.nb > ACQ_BURST - acq.len_bank[acq.fill])
+                        acq.nb = ACQ_BURST - acq.len_bank[acq.fill];
+                if (acq.nb == 0)
+                        continue;
+
+                // the register address stays on the fifo for the following reads
+                acq_set(FR_I2C_WRITE, 1, MPU_FIFO_R_W, 0);
+                ACQ_XFER(pt);
+
+                for (acq.i = 0; acq.i < acq.nb; acq.i++) {
+                        acq_set(FR_I2C_READ, MPU_SAMPLE_SIZE, 0, 0);
+                        ACQ_XFER(pt);
+
+                        acc = &acq.bank[acq.fill][acq.len_bank[acq.fill]++];
+                        acc->x = (acq.data[0] << 8) | acq.data[1];
+                        acc->y = (acq.data[2] << 8) | acq.data[3];
+                        acc->z = (acq.data[4] << 8) | acq.data[5];
+                }
+
+                // hand the bank to the filter once it is done with the other one
+                if (acq.len_bank[acq.fill ^ 1] == 0)
+                        acq.fill ^= 1;
+        }
+
+        PT_END(pt);
+}
+
+// first order low pass filter of a sample
+static s16 acq_filter(s32* filt, s16 val)
+{
+        *filt += (((s32)val << 8) - *filt) >> ACQ_FILTER;
+
+        return *filt >> 8;
+}
+
+// filter the bank not being filled
+static void acq_filter_bank(void)
+{
+        acq_acc_t* bank = acq.bank[acq.fill ^ 1];
+        u8 i;
+
+        for (i = 0; i < acq.len_bank[acq.fill ^ 1]; i++) {
+                acq.acc.x = acq_filter(&acq.filt[0], bank[i].x);
+                acq.acc.y = acq_filter(&acq.filt[1], bank[i].y);
+                acq.acc.z = acq_filter(&acq.filt[2], bank[i].z);
+                acq.seq++;
+        }
+
+        acq.len_bank[acq.fill ^ 1] = 0;
+}
+
+
+// ------------------------------------------
+// public functions
+//
+
+void ACQ_init(void)
+{
+        // init
+        FIFO_init(&acq.in_fifo, &acq.in_buf, IN_FIFO_SIZE, sizeof(frame_t));
+
+        acq.interf.channel = 11;
+        acq.interf.cmde_mask = _CM(FR_I2C_WRITE) | _CM(FR_I2C_READ);
+        acq.interf.queue = &acq.in_fifo;
+        rte_register(&acq.interf);
+
+        acq.failed = 0;
+        acq.on = 0;
+        acq.fill = 0;
+        acq.len_bank[0] = 0;
+        acq.len_bank[1] = 0;
+        acq.filt[0] = 0;
+        acq.filt[1] = 0;
+        acq.filt[2] = 0;
+        acq.seq = 0;
+        acq.sending = 0;
+
+        // the bursts are posted by the timer2 interrupt
+        RING_init(&acq.ev, acq.ev_buf, EV_RING_SIZE);
+        tmb_alarm_init(&acq.alarm, &acq.ev, ACQ_EV_BURST);
+
+        PT_INIT(&acq.pt);
+}
+
+
+u8 ACQ_run(void)
+{
+        prf_queue(PRF_Q_ACQ_IN, FIFO_full(&acq.in_fifo));
+
+        (void)PT_SCHEDULE(acq_thread(&acq.pt));
+
+        if (acq.len_bank[acq.fill ^ 1])
+                acq_filter_bank();
+
+        // the I2C transfers end on the TWI interrupt
+        return FIFO_full(&acq.in_fifo) || RING_count(&acq.ev) || acq.sending;
+}
+
+
+void ACQ_enable(u8 on)
+{
+        acq.on = on;
+}
+
+
+u8 ACQ_get(acq_acc_t* acc)
+{
+        *acc = acq.acc;
+
+        return acq.seq;
+}
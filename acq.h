@@ -1,10 +1,49 @@
 #ifndef __ACQ_H__
 # define __ACQ_H__
 
+#include "type_def.h"
+
+
+// ------------------------------------------
+// public types
+//
+
+// acceleration along the sensor axes
+typedef struct {
+	s16 x;
+	s16 y;
+	s16 z;
+} acq_acc_t;
+
+
+// ------------------------------------------
+// public definitions
+//
+
+#define ACQ_1_G		4096	// acceleration unit
+#define ACQ_RANGE	8	// [g] the range is +/- 8 g
+#define ACQ_RATE	500	// [Hz] filtered samples rate
+
+// the sensor z axis is along the rocket, pointing up on the pad
+#define ACC_VERTICAL(acc)	((acc).z)
+
+
+// ------------------------------------------
+// public functions
+//
 
 // acquisition handling
 extern void ACQ_init(void);
 
-extern void ACQ_run(void);
+// return non-zero while some work is pending
+extern u8 ACQ_run(void);
+
+// start or stop the sensor bursts, they are stopped at start-up
+// the I2C bus is left idle while no module needs the accelerations
+extern void ACQ_enable(u8 on);
+
+// get the latest filtered acceleration and return its sequence number
+// a consumer detects a new sample by a change of the sequence number
+extern u8 ACQ_get(acq_acc_t* acc);
 
 #endif	// __ACQ_H__
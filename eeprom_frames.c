@@ -1,27 +1,29 @@
 #include "dispatcher.h"
 
+#include <avr/pgmspace.h>
+
 const frame_t eeprom_frames[] __attribute__ ((section (".eeprom")))= {
 //-> minut :
-	//0x00 (  0): 0x01 0x01 0x14 0x0c 0x00 0x00 0x4d 0x04 0xee 0xff 0xff : container       
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x14, .cmde = 0x0c, .status = 0x00, .argv = {0x00, 0x4d, 0x04, 0xee, 0xff, 0xff, }
+	//0x00 (  0): 0x01 0x01 0x15 0x0c 0x00 0x00 0x4d 0x05 0xee 0xff 0xff : container       
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x15, .cmde = 0x0c, .status = 0x00, .argv = {0x00, 0x4d, 0x05, 0xee, 0xff, 0xff, }
 	},
-	//0x0b ( 11): 0x01 0x01 0x15 0x0c 0x00 0x00 0x79 0x02 0xee 0xff 0xff : container       
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x15, .cmde = 0x0c, .status = 0x00, .argv = {0x00, 0x79, 0x02, 0xee, 0xff, 0xff, }
+	//0x0b ( 11): 0x01 0x01 0x16 0x0c 0x00 0x00 0x84 0x02 0xee 0xff 0xff : container       
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x16, .cmde = 0x0c, .status = 0x00, .argv = {0x00, 0x84, 0x02, 0xee, 0xff, 0xff, }
 	},
-	//0x16 ( 22): 0x01 0x01 0x16 0x0c 0x00 0x00 0x8f 0x03 0xee 0xff 0xff : container       
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x16, .cmde = 0x0c, .status = 0x00, .argv = {0x00, 0x8f, 0x03, 0xee, 0xff, 0xff, }
+	//0x16 ( 22): 0x01 0x01 0x17 0x0c 0x00 0x00 0x9a 0x03 0xee 0xff 0xff : container       
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x17, .cmde = 0x0c, .status = 0x00, .argv = {0x00, 0x9a, 0x03, 0xee, 0xff, 0xff, }
 	},
-	//0x21 ( 33): 0x01 0x01 0x17 0x0c 0x00 0x00 0xb0 0x03 0xee 0xff 0xff : container       
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x17, .cmde = 0x0c, .status = 0x00, .argv = {0x00, 0xb0, 0x03, 0xee, 0xff, 0xff, }
+	//0x21 ( 33): 0x01 0x01 0x18 0x0c 0x00 0x00 0xbb 0x03 0xee 0xff 0xff : container       
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x18, .cmde = 0x0c, .status = 0x00, .argv = {0x00, 0xbb, 0x03, 0xee, 0xff, 0xff, }
 	},
-	//0x2c ( 44): 0x01 0x01 0x18 0x0c 0x00 0x00 0xd1 0x02 0xee 0xff 0xff : container       
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x18, .cmde = 0x0c, .status = 0x00, .argv = {0x00, 0xd1, 0x02, 0xee, 0xff, 0xff, }
+	//0x2c ( 44): 0x01 0x01 0x19 0x0c 0x00 0x00 0xdc 0x02 0xee 0xff 0xff : container       
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x19, .cmde = 0x0c, .status = 0x00, .argv = {0x00, 0xdc, 0x02, 0xee, 0xff, 0xff, }
 	},
-	//0x37 ( 55): 0x01 0x01 0x19 0x0c 0x00 0x00 0xe7 0x02 0xee 0xff 0xff : container       
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x19, .cmde = 0x0c, .status = 0x00, .argv = {0x00, 0xe7, 0x02, 0xee, 0xff, 0xff, }
+	//0x37 ( 55): 0x01 0x01 0x1a 0x0c 0x00 0x00 0xf2 0x02 0xee 0xff 0xff : container       
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x1a, .cmde = 0x0c, .status = 0x00, .argv = {0x00, 0xf2, 0x02, 0xee, 0xff, 0xff, }
 	},
-	//0x42 ( 66): 0x01 0x01 0x1a 0x0c 0x00 0x00 0xfd 0x03 0xee 0xff 0xff : container       
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x1a, .cmde = 0x0c, .status = 0x00, .argv = {0x00, 0xfd, 0x03, 0xee, 0xff, 0xff, }
+	//0x42 ( 66): 0x01 0x01 0x1b 0x0c 0x00 0x01 0x08 0x03 0xee 0xff 0xff : container       
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x1b, .cmde = 0x0c, .status = 0x00, .argv = {0x01, 0x08, 0x03, 0xee, 0xff, 0xff, }
 	},
 
 	//-- start of extended zone --
@@ -34,52 +36,142 @@ const frame_t eeprom_frames[] __attribute__ ((section (".eeprom")))= {
 	//0x63 ( 99): 0x01 0x01 0x02 0x16 0x00 0x00 0x55 0xff 0xff 0xff 0xff : minut_time_out  
 	{ .dest = 0x01, .orig = 0x01, .t_id = 0x02, .cmde = 0x16, .status = 0x00, .argv = {0x00, 0x55, 0xff, 0xff, 0xff, 0xff, }
 	},
-	//0x6e (110): 0x01 0x01 0x03 0x3f 0x00 0xff 0xff 0xff 0xff 0xff 0xff : appli_start     
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x03, .cmde = 0x3f, .status = 0x00, .argv = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, }
+	//0x6e (110): 0x01 0x01 0x03 0x15 0x00 0x01 0x1e 0x0a 0x32 0xff 0xff : take_off_thres  
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x03, .cmde = 0x15, .status = 0x00, .argv = {0x01, 0x1e, 0x0a, 0x32, 0xff, 0xff, }
+	},
+	//0x79 (121): 0x01 0x01 0x04 0x3f 0x00 0xff 0xff 0xff 0xff 0xff 0xff : appli_start     
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x04, .cmde = 0x3f, .status = 0x00, .argv = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, }
+	},
+	//0x84 (132): 0x01 0x01 0x05 0x10 0x00 0x5e 0x00 0xff 0xff 0xff 0xff : state           
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x05, .cmde = 0x10, .status = 0x00, .argv = {0x5e, 0x00, 0xff, 0xff, 0xff, 0xff, }
+	},
+	//0x8f (143): 0x01 0x01 0x06 0x2a 0x00 0xa1 0x00 0x0a 0x05 0xff 0xff : led_cmd         
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x06, .cmde = 0x2a, .status = 0x00, .argv = {0xa1, 0x00, 0x0a, 0x05, 0xff, 0xff, }
+	},
+	//0x9a (154): 0x01 0x01 0x07 0x10 0x00 0x5e 0x01 0xff 0xff 0xff 0xff : state           
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x07, .cmde = 0x10, .status = 0x00, .argv = {0x5e, 0x01, 0xff, 0xff, 0xff, 0xff, }
+	},
+	//0xa5 (165): 0x01 0x01 0x08 0x17 0x00 0xc0 0x09 0xff 0xff 0xff 0xff : minut_servo_cmd 
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x08, .cmde = 0x17, .status = 0x00, .argv = {0xc0, 0x09, 0xff, 0xff, 0xff, 0xff, }
+	},
+	//0xb0 (176): 0x01 0x01 0x09 0x2a 0x00 0xa1 0x00 0x0a 0x28 0xff 0xff : led_cmd         
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x09, .cmde = 0x2a, .status = 0x00, .argv = {0xa1, 0x00, 0x0a, 0x28, 0xff, 0xff, }
+	},
+	//0xbb (187): 0x01 0x01 0x0a 0x10 0x00 0x5e 0x02 0xff 0xff 0xff 0xff : state           
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x0a, .cmde = 0x10, .status = 0x00, .argv = {0x5e, 0x02, 0xff, 0xff, 0xff, 0xff, }
+	},
+	//0xc6 (198): 0x01 0x01 0x0b 0x17 0x00 0xc0 0xc1 0xff 0xff 0xff 0xff : minut_servo_cmd 
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x0b, .cmde = 0x17, .status = 0x00, .argv = {0xc0, 0xc1, 0xff, 0xff, 0xff, 0xff, }
+	},
+	//0xd1 (209): 0x01 0x01 0x0c 0x2a 0x00 0xa1 0x00 0x28 0x0a 0xff 0xff : led_cmd         
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x0c, .cmde = 0x2a, .status = 0x00, .argv = {0xa1, 0x00, 0x28, 0x0a, 0xff, 0xff, }
+	},
+	//0xdc (220): 0x01 0x01 0x0d 0x10 0x00 0x5e 0x04 0xff 0xff 0xff 0xff : state           
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x0d, .cmde = 0x10, .status = 0x00, .argv = {0x5e, 0x04, 0xff, 0xff, 0xff, 0xff, }
+	},
+	//0xe7 (231): 0x01 0x01 0x0e 0x2a 0x00 0xa1 0x00 0x5a 0x0a 0xff 0xff : led_cmd         
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x0e, .cmde = 0x2a, .status = 0x00, .argv = {0xa1, 0x00, 0x5a, 0x0a, 0xff, 0xff, }
+	},
+	//0xf2 (242): 0x01 0x01 0x0f 0x10 0x00 0x5e 0x10 0xff 0xff 0xff 0xff : state           
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x0f, .cmde = 0x10, .status = 0x00, .argv = {0x5e, 0x10, 0xff, 0xff, 0xff, 0xff, }
+	},
+	//0xfd (253): 0x01 0x01 0x10 0x2a 0x00 0xa1 0x00 0x0a 0x0a 0xff 0xff : led_cmd         
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x10, .cmde = 0x2a, .status = 0x00, .argv = {0xa1, 0x00, 0x0a, 0x0a, 0xff, 0xff, }
+	},
+	//0x108 (264): 0x01 0x01 0x11 0x10 0x00 0x5e 0x10 0xff 0xff 0xff 0xff : state           
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x11, .cmde = 0x10, .status = 0x00, .argv = {0x5e, 0x10, 0xff, 0xff, 0xff, 0xff, }
+	},
+	//0x113 (275): 0x01 0x01 0x12 0x17 0x00 0xc0 0x09 0xff 0xff 0xff 0xff : minut_servo_cmd 
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x12, .cmde = 0x17, .status = 0x00, .argv = {0xc0, 0x09, 0xff, 0xff, 0xff, 0xff, }
+	},
+	//0x11e (286): 0x01 0x01 0x13 0x2a 0x00 0xa1 0x00 0x14 0x14 0xff 0xff : led_cmd         
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x13, .cmde = 0x2a, .status = 0x00, .argv = {0xa1, 0x00, 0x14, 0x14, 0xff, 0xff, }
+	},
+};
+
+const frame_t flash_frames[] PROGMEM = {
+//-> minut :
+	//0x00 (  0): 0x01 0x01 0x15 0x0c 0x00 0x00 0x4d 0x05 0xee 0xff 0xff : container       
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x15, .cmde = 0x0c, .status = 0x00, .argv = {0x00, 0x4d, 0x05, 0xee, 0xff, 0xff, }
+	},
+	//0x0b ( 11): 0x01 0x01 0x16 0x0c 0x00 0x00 0x84 0x02 0xee 0xff 0xff : container       
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x16, .cmde = 0x0c, .status = 0x00, .argv = {0x00, 0x84, 0x02, 0xee, 0xff, 0xff, }
+	},
+	//0x16 ( 22): 0x01 0x01 0x17 0x0c 0x00 0x00 0x9a 0x03 0xee 0xff 0xff : container       
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x17, .cmde = 0x0c, .status = 0x00, .argv = {0x00, 0x9a, 0x03, 0xee, 0xff, 0xff, }
+	},
+	//0x21 ( 33): 0x01 0x01 0x18 0x0c 0x00 0x00 0xbb 0x03 0xee 0xff 0xff : container       
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x18, .cmde = 0x0c, .status = 0x00, .argv = {0x00, 0xbb, 0x03, 0xee, 0xff, 0xff, }
+	},
+	//0x2c ( 44): 0x01 0x01 0x19 0x0c 0x00 0x00 0xdc 0x02 0xee 0xff 0xff : container       
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x19, .cmde = 0x0c, .status = 0x00, .argv = {0x00, 0xdc, 0x02, 0xee, 0xff, 0xff, }
+	},
+	//0x37 ( 55): 0x01 0x01 0x1a 0x0c 0x00 0x00 0xf2 0x02 0xee 0xff 0xff : container       
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x1a, .cmde = 0x0c, .status = 0x00, .argv = {0x00, 0xf2, 0x02, 0xee, 0xff, 0xff, }
+	},
+	//0x42 ( 66): 0x01 0x01 0x1b 0x0c 0x00 0x01 0x08 0x03 0xee 0xff 0xff : container       
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x1b, .cmde = 0x0c, .status = 0x00, .argv = {0x01, 0x08, 0x03, 0xee, 0xff, 0xff, }
+	},
+
+	//-- start of extended zone --
+	//0x4d ( 77): 0x01 0x01 0x00 0x18 0x00 0xc0 0x5a 0x09 0xa6 0xff 0xff : minut_servo_info
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x00, .cmde = 0x18, .status = 0x00, .argv = {0xc0, 0x5a, 0x09, 0xa6, 0xff, 0xff, }
+	},
+	//0x58 ( 88): 0x01 0x01 0x01 0x18 0x00 0xc0 0x5a 0xc1 0x2d 0xff 0xff : minut_servo_info
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x01, .cmde = 0x18, .status = 0x00, .argv = {0xc0, 0x5a, 0xc1, 0x2d, 0xff, 0xff, }
+	},
+	//0x63 ( 99): 0x01 0x01 0x02 0x16 0x00 0x00 0x55 0xff 0xff 0xff 0xff : minut_time_out  
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x02, .cmde = 0x16, .status = 0x00, .argv = {0x00, 0x55, 0xff, 0xff, 0xff, 0xff, }
+	},
+	//0x6e (110): 0x01 0x01 0x03 0x15 0x00 0x01 0x1e 0x0a 0x32 0xff 0xff : take_off_thres  
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x03, .cmde = 0x15, .status = 0x00, .argv = {0x01, 0x1e, 0x0a, 0x32, 0xff, 0xff, }
+	},
+	//0x79 (121): 0x01 0x01 0x04 0x3f 0x00 0xff 0xff 0xff 0xff 0xff 0xff : appli_start     
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x04, .cmde = 0x3f, .status = 0x00, .argv = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, }
 	},
-	//0x79 (121): 0x01 0x01 0x04 0x10 0x00 0x5e 0x00 0xff 0xff 0xff 0xff : state           
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x04, .cmde = 0x10, .status = 0x00, .argv = {0x5e, 0x00, 0xff, 0xff, 0xff, 0xff, }
+	//0x84 (132): 0x01 0x01 0x05 0x10 0x00 0x5e 0x00 0xff 0xff 0xff 0xff : state           
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x05, .cmde = 0x10, .status = 0x00, .argv = {0x5e, 0x00, 0xff, 0xff, 0xff, 0xff, }
 	},
-	//0x84 (132): 0x01 0x01 0x05 0x2a 0x00 0xa1 0x00 0x0a 0x05 0xff 0xff : led_cmd         
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x05, .cmde = 0x2a, .status = 0x00, .argv = {0xa1, 0x00, 0x0a, 0x05, 0xff, 0xff, }
+	//0x8f (143): 0x01 0x01 0x06 0x2a 0x00 0xa1 0x00 0x0a 0x05 0xff 0xff : led_cmd         
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x06, .cmde = 0x2a, .status = 0x00, .argv = {0xa1, 0x00, 0x0a, 0x05, 0xff, 0xff, }
 	},
-	//0x8f (143): 0x01 0x01 0x06 0x10 0x00 0x5e 0x01 0xff 0xff 0xff 0xff : state           
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x06, .cmde = 0x10, .status = 0x00, .argv = {0x5e, 0x01, 0xff, 0xff, 0xff, 0xff, }
+	//0x9a (154): 0x01 0x01 0x07 0x10 0x00 0x5e 0x01 0xff 0xff 0xff 0xff : state           
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x07, .cmde = 0x10, .status = 0x00, .argv = {0x5e, 0x01, 0xff, 0xff, 0xff, 0xff, }
 	},
-	//0x9a (154): 0x01 0x01 0x07 0x17 0x00 0xc0 0x09 0xff 0xff 0xff 0xff : minut_servo_cmd 
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x07, .cmde = 0x17, .status = 0x00, .argv = {0xc0, 0x09, 0xff, 0xff, 0xff, 0xff, }
+	//0xa5 (165): 0x01 0x01 0x08 0x17 0x00 0xc0 0x09 0xff 0xff 0xff 0xff : minut_servo_cmd 
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x08, .cmde = 0x17, .status = 0x00, .argv = {0xc0, 0x09, 0xff, 0xff, 0xff, 0xff, }
 	},
-	//0xa5 (165): 0x01 0x01 0x08 0x2a 0x00 0xa1 0x00 0x0a 0x28 0xff 0xff : led_cmd         
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x08, .cmde = 0x2a, .status = 0x00, .argv = {0xa1, 0x00, 0x0a, 0x28, 0xff, 0xff, }
+	//0xb0 (176): 0x01 0x01 0x09 0x2a 0x00 0xa1 0x00 0x0a 0x28 0xff 0xff : led_cmd         
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x09, .cmde = 0x2a, .status = 0x00, .argv = {0xa1, 0x00, 0x0a, 0x28, 0xff, 0xff, }
 	},
-	//0xb0 (176): 0x01 0x01 0x09 0x10 0x00 0x5e 0x02 0xff 0xff 0xff 0xff : state           
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x09, .cmde = 0x10, .status = 0x00, .argv = {0x5e, 0x02, 0xff, 0xff, 0xff, 0xff, }
+	//0xbb (187): 0x01 0x01 0x0a 0x10 0x00 0x5e 0x02 0xff 0xff 0xff 0xff : state           
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x0a, .cmde = 0x10, .status = 0x00, .argv = {0x5e, 0x02, 0xff, 0xff, 0xff, 0xff, }
 	},
-	//0xbb (187): 0x01 0x01 0x0a 0x17 0x00 0xc0 0xc1 0xff 0xff 0xff 0xff : minut_servo_cmd 
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x0a, .cmde = 0x17, .status = 0x00, .argv = {0xc0, 0xc1, 0xff, 0xff, 0xff, 0xff, }
+	//0xc6 (198): 0x01 0x01 0x0b 0x17 0x00 0xc0 0xc1 0xff 0xff 0xff 0xff : minut_servo_cmd 
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x0b, .cmde = 0x17, .status = 0x00, .argv = {0xc0, 0xc1, 0xff, 0xff, 0xff, 0xff, }
 	},
-	//0xc6 (198): 0x01 0x01 0x0b 0x2a 0x00 0xa1 0x00 0x28 0x0a 0xff 0xff : led_cmd         
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x0b, .cmde = 0x2a, .status = 0x00, .argv = {0xa1, 0x00, 0x28, 0x0a, 0xff, 0xff, }
+	//0xd1 (209): 0x01 0x01 0x0c 0x2a 0x00 0xa1 0x00 0x28 0x0a 0xff 0xff : led_cmd         
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x0c, .cmde = 0x2a, .status = 0x00, .argv = {0xa1, 0x00, 0x28, 0x0a, 0xff, 0xff, }
 	},
-	//0xd1 (209): 0x01 0x01 0x0c 0x10 0x00 0x5e 0x04 0xff 0xff 0xff 0xff : state           
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x0c, .cmde = 0x10, .status = 0x00, .argv = {0x5e, 0x04, 0xff, 0xff, 0xff, 0xff, }
+	//0xdc (220): 0x01 0x01 0x0d 0x10 0x00 0x5e 0x04 0xff 0xff 0xff 0xff : state           
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x0d, .cmde = 0x10, .status = 0x00, .argv = {0x5e, 0x04, 0xff, 0xff, 0xff, 0xff, }
 	},
-	//0xdc (220): 0x01 0x01 0x0d 0x2a 0x00 0xa1 0x00 0x5a 0x0a 0xff 0xff : led_cmd         
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x0d, .cmde = 0x2a, .status = 0x00, .argv = {0xa1, 0x00, 0x5a, 0x0a, 0xff, 0xff, }
+	//0xe7 (231): 0x01 0x01 0x0e 0x2a 0x00 0xa1 0x00 0x5a 0x0a 0xff 0xff : led_cmd         
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x0e, .cmde = 0x2a, .status = 0x00, .argv = {0xa1, 0x00, 0x5a, 0x0a, 0xff, 0xff, }
 	},
-	//0xe7 (231): 0x01 0x01 0x0e 0x10 0x00 0x5e 0x10 0xff 0xff 0xff 0xff : state           
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x0e, .cmde = 0x10, .status = 0x00, .argv = {0x5e, 0x10, 0xff, 0xff, 0xff, 0xff, }
+	//0xf2 (242): 0x01 0x01 0x0f 0x10 0x00 0x5e 0x10 0xff 0xff 0xff 0xff : state           
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x0f, .cmde = 0x10, .status = 0x00, .argv = {0x5e, 0x10, 0xff, 0xff, 0xff, 0xff, }
 	},
-	//0xf2 (242): 0x01 0x01 0x0f 0x2a 0x00 0xa1 0x00 0x0a 0x0a 0xff 0xff : led_cmd         
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x0f, .cmde = 0x2a, .status = 0x00, .argv = {0xa1, 0x00, 0x0a, 0x0a, 0xff, 0xff, }
+	//0xfd (253): 0x01 0x01 0x10 0x2a 0x00 0xa1 0x00 0x0a 0x0a 0xff 0xff : led_cmd         
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x10, .cmde = 0x2a, .status = 0x00, .argv = {0xa1, 0x00, 0x0a, 0x0a, 0xff, 0xff, }
 	},
-	//0xfd (253): 0x01 0x01 0x10 0x10 0x00 0x5e 0x10 0xff 0xff 0xff 0xff : state           
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x10, .cmde = 0x10, .status = 0x00, .argv = {0x5e, 0x10, 0xff, 0xff, 0xff, 0xff, }
+	//0x108 (264): 0x01 0x01 0x11 0x10 0x00 0x5e 0x10 0xff 0xff 0xff 0xff : state           
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x11, .cmde = 0x10, .status = 0x00, .argv = {0x5e, 0x10, 0xff, 0xff, 0xff, 0xff, }
 	},
-	//0x108 (264): 0x01 0x01 0x11 0x17 0x00 0xc0 0x09 0xff 0xff 0xff 0xff : minut_servo_cmd 
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x11, .cmde = 0x17, .status = 0x00, .argv = {0xc0, 0x09, 0xff, 0xff, 0xff, 0xff, }
+	//0x113 (275): 0x01 0x01 0x12 0x17 0x00 0xc0 0x09 0xff 0xff 0xff 0xff : minut_servo_cmd 
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x12, .cmde = 0x17, .status = 0x00, .argv = {0xc0, 0x09, 0xff, 0xff, 0xff, 0xff, }
 	},
-	//0x113 (275): 0x01 0x01 0x12 0x2a 0x00 0xa1 0x00 0x14 0x14 0xff 0xff : led_cmd         
-	{ .dest = 0x01, .orig = 0x01, .t_id = 0x12, .cmde = 0x2a, .status = 0x00, .argv = {0xa1, 0x00, 0x14, 0x14, 0xff, 0xff, }
+	//0x11e (286): 0x01 0x01 0x13 0x2a 0x00 0xa1 0x00 0x14 0x14 0xff 0xff : led_cmd         
+	{ .dest = 0x01, .orig = 0x01, .t_id = 0x13, .cmde = 0x2a, .status = 0x00, .argv = {0xa1, 0x00, 0x14, 0x14, 0xff, 0xff, }
 	},
 };
\ No newline at end of file
@@ -90,16 +90,32 @@ def compute_EEPROM(module, fd):
 		fd.write('\t},\n')
 
 
+class Image(list):
+	"""collect the computed memory content so it can be written twice"""
+	def write(self, s):
+		self.append(s)
+
+
 #----------------------------
 # main
 if __name__ == '__main__':
+	# computed once, the containers frames get a new transaction id each time
+	image = Image()
+	compute_EEPROM(minut, image)
+
 	fd = open(sys.argv[1], 'w')
 	fd.write('#include "dispatcher.h"\n')
 	fd.write('\n')
+	fd.write('#include <avr/pgmspace.h>\n')
+	fd.write('\n')
 	fd.write('const frame_t eeprom_frames[] __attribute__ ((section (".eeprom")))= {\n')
+	fd.write(''.join(image))
+	fd.write('};\n')
+	fd.write('\n')
 
-	compute_EEPROM(minut, fd)
-
+	# the same frames in flash, the minut containers sequences are run from it
+	fd.write('const frame_t flash_frames[] PROGMEM = {\n')
+	fd.write(''.join(image))
 	fd.write('};')
 	fd.close()
 
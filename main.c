@@ -1,8 +1,13 @@
 #include "minut.h"
 #include "servo.h"
 #include "tk-off.h"
+#include "acq.h"
+#include "timebase.h"
+#include "pool.h"
+#include "route.h"
+#include "prof.h"
+#include "rec.h"
 
-#include "drivers/timer2.h"
 #include "utils/pt.h"
 #include "utils/time.h"
 
@@ -19,20 +24,43 @@
 
 #include "avr/io.h"
 #include "avr/interrupt.h"
+#include "avr/sleep.h"
 
 #if 0
 arduino        atmega        function
 -------+-------+--------
 
-D8      PB0     take-off detection
-D9      PB1     servo pwm
+D8      PB0     take-off detection (ICP1)
+D9      PB1     servo pwm (para)
+D10     PB2     servo pwm (main)
+D11     PB3     cone door switch
 sck     PB5     led
+A0      PC0     servo position feedback (para)
+A1      PC1     servo position feedback (main)
+A4      PC4     accelerometer I2C SDA
+A5      PC5     accelerometer I2C SCL
 
 +9V     PWR     power in
 GND     GND     ground
 
 #endif
 
+// ------------------------------------------
+// private definitions
+//
+
+// the common modules of the support library give no status
+// so they are deemed busy for some passes after any activity:
+// a wake-up, a time base interrupt or pending application work
+// each pass moves a frame through their queues, which are shorter
+// only a bus frame received by their interrupts during the very last pass
+// waits for the next interrupt, at most a time base step (15.36 ms)
+#define COMMON_PASSES   4
+
+// set in GPIOR0 while sleeping, the ratio is visible in the vcd trace
+#define IDLE_MARK       _BV(0)
+
+
 // ------------------------------------------
 // simavr options
 //
@@ -44,7 +72,16 @@ AVR_MCU(16000000, "atmega328p");
 const struct avr_mmcu_vcd_trace_t simavr_conf[]  _MMCU_ = {
         { AVR_MCU_VCD_SYMBOL("take_off"), .mask = _BV(PORTB0), .what = (void*)&PORTB, },
         { AVR_MCU_VCD_SYMBOL("servo"), .mask = _BV(PORTB1), .what = (void*)&PORTB, },
+        { AVR_MCU_VCD_SYMBOL("servo_main"), .mask = _BV(PORTB2), .what = (void*)&PORTB, },
         { AVR_MCU_VCD_SYMBOL("led"), .mask = _BV(PORTB5), .what = (void*)&PORTB, },
+        { AVR_MCU_VCD_SYMBOL("sleep"), .mask = IDLE_MARK, .what = (void*)&GPIOR0, },
+        { AVR_MCU_VCD_SYMBOL("section"), .what = (void*)&PRF_SECTION, },
+#ifdef ISR_STATS
+        { AVR_MCU_VCD_SYMBOL("lat_tmb"), .what = (void*)&prf_lat[PRF_LAT_TMB], },
+        { AVR_MCU_VCD_SYMBOL("lat_capt"), .what = (void*)&prf_lat[PRF_LAT_TMR1_CAPT], },
+        { AVR_MCU_VCD_SYMBOL("lat_servo"), .what = (void*)&prf_lat[PRF_LAT_TMR1_A], },
+        { AVR_MCU_VCD_SYMBOL("lat_servo_main"), .what = (void*)&prf_lat[PRF_LAT_TMR1_B], },
+#endif
 
 //        { AVR_MCU_VCD_SYMBOL("TWDR"), .what = (void*)&TWDR, },
 //
@@ -77,41 +114,44 @@ const struct avr_mmcu_vcd_trace_t simavr_conf[]  _MMCU_ = {
 };
 
 
-// ------------------------------------------
-// private definitions
-//
-
-//#define TIMER2_TOP_VALUE        78        // @ 8 MHz ==> 10 ms
-#define TIMER2_TOP_VALUE        156        // @ 16 MHz ==> 10 ms
-
-
 // ------------------------------------------
 // private variables
 //
 
+static u8 common;       // passes left to the common modules before sleeping
+
 
 // ------------------------------
 // private functions
 //
 
-static void time(void* misc)
+// the cpu idles until the next interrupt if no work is pending
+// the check and the sleep are atomic: an interrupt posting some work
+// after the check is served right after the sleep instruction which it ends
+static void idle(u8 busy)
 {
-        (void)misc;
-
-        // time update
-        TIME_incr();
-}
-
-
-static u32 time_adjust(void)
-{
-        u8 val;
-        u32 incr;
-
-        val = TMR2_get_value();
-        incr = TIME_get_incr();
+        cli();
+
+        if (tmb_activity())
+                busy = 1;
+
+        if (busy) {
+                common = COMMON_PASSES;
+        } else if (common) {
+                common--;
+        } else {
+                GPIOR0 |= IDLE_MARK;
+                sleep_enable();
+                sei();
+                sleep_cpu();
+                sleep_disable();
+                GPIOR0 &= ~IDLE_MARK;
+
+                // the interrupt may have been served by a common module
+                common = COMMON_PASSES;
+        }
 
-        return incr * val / TIMER2_TOP_VALUE;
+        sei();
 }
 
 
@@ -136,13 +176,8 @@ int main(void)
 //                MCUSR = _BV(WDRF) | _BV(BORF) | _BV(EXTRF);
 //        }
 
-        // init on-board time
-        TIME_init(time_adjust);
-        TIME_set_incr(10 * TIME_1_MSEC);
-
-        // program and start timer2 for interrupt on compare every 10 ms
-        TMR2_init(TMR2_WITH_COMPARE_INT, TMR2_PRESCALER_1024, TMR2_WGM_CTC, TIMER2_TOP_VALUE, time, NULL);
-        TMR2_start();
+        // init on-board time, timer2 only interrupts at the next deadline
+        tmb_init();
 
         // enable interrupts
         sei();
@@ -155,22 +190,53 @@ int main(void)
         //LOG_init();
         //CPU_init();
 
+        // frames shared by the application modules
+        pol_init();
+
+        // local routes between the application modules
+        rte_init();
+
+        // modules and interrupts durations
+        prf_init();
+
+        // flight recorder, the eeprom is set up by the basic module
+        rec_init();
+
         mnt_init();
         srv_init();
         tkf_init();
+        ACQ_init();
+
+        // every application interface is registered
+        rte_build();
+
+        // the idle mode keeps the timers, the TWI and the UART running
+        set_sleep_mode(SLEEP_MODE_IDLE);
+        common = COMMON_PASSES;
 
         while (1) {
+                u8 busy = 0;
+
                 // run every common module
-                dpt_run();
-                BSC_run();
-                CMN_run();
+                PRF_RUN(PRF_DPT, dpt_run());
+                PRF_RUN(PRF_BSC, BSC_run());
+                PRF_RUN(PRF_CMN, CMN_run());
                 //NAT_run();
                 //LOG_run();
                 //CPU_run();
 
-                mnt_run();
-                srv_run();
-                tkf_run();
+                // each application module reports its pending work
+                PRF_RUN(PRF_MNT, busy |= mnt_run());
+                PRF_RUN(PRF_SRV, busy |= srv_run());
+                PRF_RUN(PRF_TKF, busy |= tkf_run());
+                PRF_RUN(PRF_ACQ, busy |= ACQ_run());
+                PRF_RUN(PRF_REC, busy |= rec_run());
+                busy |= prf_run();
+                busy |= rte_run();
+
+                // the cpu idles until the next interrupt (time base deadline,
+                // I2C, UART, eeprom) once no module has work
+                idle(busy);
 
                 //#define DEBUG
 #if DEBUG
@@ -1,4 +1,11 @@
 #include "minut.h"
+#include "timebase.h"
+#include "acq.h"
+#include "prof.h"
+#include "rec.h"
+#include "pool.h"
+#include "route.h"
+#include "ring.h"
 
 #include "type_def.h"
 #include "dispatcher.h"
@@ -9,6 +16,8 @@
 #include "utils/fifo.h"
 #include "utils/state_machine.h"
 
+#include "drivers/eeprom.h"
+
 #include <avr/io.h>
 #include <avr/pgmspace.h>
 
@@ -20,18 +29,43 @@
 // private definitions
 //
 
-#define NB_EVENTS	5
+#define NB_EVENTS	4	// power of 2 for the rings
 #define NB_IN_FR	3
 #define NB_OUT_FR	4
 
+// outgoing lanes, the high one is always sent first
+#define MNT_HIGH	0	// actuation containers
+#define MNT_LOW		1	// cosmetic containers and responses
+#define NB_LANES	2
+
+// preset containers, the slot 0 is run by the basic module at reset
+#define NB_SLOTS	7
+#define CONTAINER_EEPROM	0xee	// container argv[3], sequence stored in eeprom
+
 #define CONE_DDR			DDRB
+#define CONE_PORT			PORTB
 #define CONE				PINB
 #define CONE_PIN			PB3
 #define CONE_STATE_CLOSED	0
 #define CONE_STATE_OPEN		_BV(CONE_PIN)
 
-#define SAMPLING_START		(2 * TIME_1_SEC)
-#define SAMPLING_PERIOD		(100 * TIME_1_MSEC)
+// the door is slowly sampled when idle
+// and fast for some time after each servo command
+#define SAMPLING_START		(2 * TMB_1_SEC)
+#define SAMPLING_PERIOD		(100 * TMB_1_MSEC)
+#define SAMPLING_FAST		(5 * TMB_1_SEC)
+
+#define PARACHUTE_RETRY		(2 * TMB_1_SEC)	// open command retry until the door is seen open
+#define PARACHUTE_RETRIES	3		// open commands retried before giving up on the door sensor
+
+#define SERVO_DONE		0xd0	// servo move completion status, FR_MINUT_SERVO_CMD argv[3]
+
+// deployment modes, FR_MINUT_TIME_OUT sub-commands 0x01 save and 0xfe read
+#define DEPLOY_TIMER		0x00	// at the open time from take-off
+#define DEPLOY_APOGEE		0x01	// at the estimated apogee, the open time is the upper bound
+
+#define DEPLOY_LOCKOUT		20	// [0.1 s] no apogee during the motor burn
+#define DEPLOY_GAP		200	// [samples] longest integration gap from the take-off edge
 
 
 // ------------------------------------------
@@ -42,8 +76,24 @@ typedef enum {
 	mnt_EV_NONE,
 	mnt_EV_TIME_OUT,
 	mnt_EV_TAKE_OFF,
+	mnt_EV_SERVO_DONE,
+	mnt_EV_DOOR_SAMPLE,
+	mnt_EV_DOOR_OPEN,
+	mnt_EV_DOOR_CLOSED,
+	mnt_EV_DEPLOYED,
 } mnt_event_t;
 
+// recorded states, numbered as their preset container
+typedef enum {
+	mnt_ST_INIT = 1,
+	mnt_ST_PARA_OPENING,
+	mnt_ST_PARA_CLOSING,
+	mnt_ST_WAITING,
+	mnt_ST_FLIGHT,
+	mnt_ST_PARACHUTE,
+	mnt_ST_DEPLOYED,
+} mnt_state_id_t;
+
 
 // ------------------------------------------
 // private variables
@@ -52,42 +102,77 @@ typedef enum {
 struct {
 	dpt_interface_t interf;	// dispatcher interface
 
-	pt_t pt_chk_time_out;	// checking time-out thread
 	pt_t pt_chk_cmds;	// checking commands thread
 	pt_t pt_out;		// sending thread
+	pt_t pt_flash;		// flash copy checking thread
 
 	stm_t stm;
 
-	volatile u32 time_out;	// time-out target time
+	tmb_alarm_t time_out;	// time-out alarm
+	u32 take_off_time;	// take-off edge time [us]
 	u32 sampling_rate;	// sampling rate for door changings
-	u32 take_off_time_out;	// take-off scan interval time
-	u32 door_time_out;	// door scan interval time
-	u32 check_time_out;	// state scan interval time
+
+	// door sensing
+	tmb_alarm_t door;	// sampling alarm
+	u32 door_sample;	// next sampling time
+	u32 door_fast_end;	// end of the fast sampling, only valid while door_fast is set
+	u32 door_cmd_time;	// time of the last servo command
+	u32 door_delay;		// [us] actuation time of the last door change
+	u8 door_state;		// CONE_STATE_OPEN or CONE_STATE_CLOSED
+	u8 retries;		// open commands sent in the parachute state
 
 	u8 open_time;		// open time [0.0; 25.5] seconds from take-off detection
 
-	// events fifo
-	fifo_t ev_fifo;
-	mnt_event_t ev_buf[NB_EVENTS];
+	// apogee estimation
+	u8 deploy;		// deployment mode
+	u8 lockout;		// [0.1 s] no apogee before this time from take-off
+	u8 flight;		// the flight state is active
+	u8 acq_seq;		// sequence number of the last acceleration sample
+	s32 vel;		// vertical velocity [ACQ_1_G / ACQ_RATE]
+
+	// events rings, one per producer
+	ring_t tmr_ev;		// posted by the timer2 interrupt
+	u8 tmr_ev_buf[NB_EVENTS];
+	ring_t cmd_ev;		// posted by the commands thread
+	u8 cmd_ev_buf[NB_EVENTS];
 
 	// incoming commands fifo
 	fifo_t in_fifo;
 	frame_t in_buf[NB_IN_FR];
-	frame_t in_fr;
+	frame_t in_fr;		// command being handled, not from the pool so the fifo always drains
 
-	// outcoming frames fifo
-	fifo_t out_fifo;
-	frame_t out_buf[NB_OUT_FR];
-	frame_t out_fr;		// frame for the sending thread
+	// outcoming frames handles fifos, one per lane
+	fifo_t out_fifo[NB_LANES];
+	pol_t out_buf[NB_LANES][NB_OUT_FR];
+	pol_t out_hd;		// pool frame for the sending thread
+	u8 burst;		// frames sent under the current dispatcher lock
+
+	// containers sequences run from the flash copy of the eeprom frames
+	u8 seq_nb;		// container being enqueued, 0 if none
+	u8 seq_i;		// its next frame
+	u8 chk_nb;		// container being checked
+	u8 chk_first;		// its next frame
+	u8 chk_len;		// its remaining frames
 
 	u8 started:1;		// signal to application can be started
+	u8 sending:1;		// an outgoing frame is waiting for the dispatcher
+	u8 flash:1;		// the flash copy matches the eeprom
+	u8 checked:1;		// the flash copy check is done
+	u8 door_fast:1;		// the door is fast sampled after a servo command
+	u8 unconfirmed:1;	// deployed without the door seen open
+
 } mnt;
 
 static const stm_transition_t init2para_opening;
 static const stm_transition_t para_opening2para_closing;
+static const stm_transition_t para_opening2para_closing_door;
 static const stm_transition_t para_closing2waiting;
+static const stm_transition_t para_closing2waiting_door;
 static const stm_transition_t waiting2flight;
 static const stm_transition_t flight2parachute;
+static const stm_transition_t parachute2parachute;
+static const stm_transition_t parachute2deployed;
+static const stm_transition_t parachute2deployed_retries;
 
 static const stm_state_t init;
 static const stm_state_t para_opening;
@@ -95,6 +180,7 @@ static const stm_state_t para_closing;
 static const stm_state_t waiting;
 static const stm_state_t flight;
 static const stm_state_t parachute;
+static const stm_state_t deployed;
 
 static u8 action_init(pt_t* pt, void* args);
 static u8 action_para_opening(pt_t* pt, void* args);
@@ -102,6 +188,7 @@ static u8 action_para_closing(pt_t* pt, void* args);
 static u8 action_waiting(pt_t* pt, void* args);
 static u8 action_flight(pt_t* pt, void* args);
 static u8 action_parachute(pt_t* pt, void* args);
+static u8 action_deployed(pt_t* pt, void* args);
 
 // transitions
 static const stm_transition_t init2para_opening = {
@@ -113,12 +200,25 @@ static const stm_transition_t init2para_opening = {
 static const stm_transition_t para_opening2para_closing = {
 	.ev = mnt_EV_TIME_OUT,
 	.st = &para_closing,
+	.tr = &para_opening2para_closing_door,
+};
+
+// the door seen open ends the check earlier
+static const stm_transition_t para_opening2para_closing_door = {
+	.ev = mnt_EV_DOOR_OPEN,
+	.st = &para_closing,
 	.tr = NULL,
 };
 
 static const stm_transition_t para_closing2waiting = {
 	.ev = mnt_EV_TIME_OUT,
 	.st = &waiting,
+	.tr = &para_closing2waiting_door,
+};
+
+static const stm_transition_t para_closing2waiting_door = {
+	.ev = mnt_EV_DOOR_CLOSED,
+	.st = &waiting,
 	.tr = NULL,
 };
 
@@ -134,6 +234,26 @@ static const stm_transition_t flight2parachute = {
 	.tr = NULL,
 };
 
+// the open command is sent again until the door is seen open
+static const stm_transition_t parachute2parachute = {
+	.ev = mnt_EV_TIME_OUT,
+	.st = &parachute,
+	.tr = &parachute2deployed,
+};
+
+static const stm_transition_t parachute2deployed = {
+	.ev = mnt_EV_DOOR_OPEN,
+	.st = &deployed,
+	.tr = &parachute2deployed_retries,
+};
+
+// the door level is open without a seen change or the retries are exhausted
+static const stm_transition_t parachute2deployed_retries = {
+	.ev = mnt_EV_DEPLOYED,
+	.st = &deployed,
+	.tr = NULL,
+};
+
 // states
 static const stm_state_t init = {
 	.action = action_init,
@@ -162,29 +282,245 @@ static const stm_state_t flight = {
 
 static const stm_state_t parachute = {
 	.action = action_parachute,
+	.transition = &parachute2parachute,
+};
+
+static const stm_state_t deployed = {
+	.action = action_deployed,
 	.transition = NULL,
 };
 
+// generated with the eeprom frames
+extern const frame_t flash_frames[];
+
+
 // ------------------------------------------
 // private functions
 //
 
+// locate the frames of the given preset container in the flash copy
+static void mnt_seq(u8 nb, u8* first, u8* len)
+{
+	frame_t fr;
+
+	memcpy_P(&fr, &flash_frames[nb], sizeof(frame_t));
+
+	// a single frame is stored in its slot
+	if ( fr.cmde != FR_CONTAINER || fr.argv[3] != CONTAINER_EEPROM ) {
+		*first = nb;
+		*len = 1;
+		return;
+	}
+
+	*first = ((fr.argv[0] << 8) | fr.argv[1]) / sizeof(frame_t);
+	*len = fr.argv[2];
+}
+
+// check the given frame of the flash copy against the eeprom one
+// return KO if the eeprom refused the read
+static u8 mnt_flash_same(u8 i, u8* same)
+{
+	frame_t fr;
+
+	// the frames start the eeprom
+	if ( KO == EEP_read(i * sizeof(frame_t), (u8*)&fr, sizeof(frame_t)) )
+		return KO;
+
+	*same = !memcmp_P(&fr, &flash_frames[i], sizeof(frame_t));
+
+	return OK;
+}
+
+// the containers can only be run from the flash if the eeprom was not changed since
+// the eeprom may still be written by the basic module, so a refused read is retried
+// meanwhile the containers are run by the common module
+static PT_THREAD( mnt_flash_check(pt_t* pt) )
+{
+	u8 same;
+
+	PT_BEGIN(pt);
+
+	PT_WAIT_UNTIL(pt, EEP_is_fini());
+
+	for ( mnt.chk_nb = 1; mnt.chk_nb < NB_SLOTS; mnt.chk_nb++ ) {
+		// the slot itself, then its sequence if any
+		PT_WAIT_UNTIL(pt, OK == mnt_flash_same(mnt.chk_nb, &same));
+		if ( !same ) {
+			mnt.checked = 1;
+			PT_EXIT(pt);
+		}
+
+		mnt_seq(mnt.chk_nb, &mnt.chk_first, &mnt.chk_len);
+		for ( ; mnt.chk_len; mnt.chk_len--, mnt.chk_first++ ) {
+			PT_WAIT_UNTIL(pt, OK == mnt_flash_same(mnt.chk_first, &same));
+			if ( !same ) {
+				mnt.checked = 1;
+				PT_EXIT(pt);
+			}
+		}
+	}
+
+	mnt.flash = 1;
+	mnt.checked = 1;
+
+	PT_END(pt);
+}
+
+// enqueue the frames of the given preset container in the given lane
+// the sequence is read from the flash so a state entry does not wait for the eeprom
+// else the container is run by the common module
+// return OK once every frame is enqueued
+static u8 mnt_container(u8 nb, u8 lane)
+{
+	pol_t hd;
+	u8 q = lane == MNT_HIGH ? PRF_Q_MNT_OUT_HIGH : PRF_Q_MNT_OUT_LOW;
+	u8 first = nb;
+	u8 len = 1;
+
+	// a new sequence, a previous one may have been left by a state change
+	if ( nb != mnt.seq_nb ) {
+		mnt.seq_nb = nb;
+		mnt.seq_i = 0;
+	}
+
+	if ( mnt.flash )
+		mnt_seq(nb, &first, &len);
+
+	while ( mnt.seq_i < len ) {
+		// the handle is only taken if it can be enqueued
+		// a full lane is accounted on the lane, a pool shortage by the pool
+		if ( !FIFO_free(&mnt.out_fifo[lane]) )
+			return prf_try(q, KO);
+		if ( KO == pol_alloc(&hd, lane == MNT_HIGH ? POL_HIGH : POL_LOW) )
+			return KO;
+
+		if ( mnt.flash )
+			memcpy_P(pol_frame(hd), &flash_frames[first + mnt.seq_i], sizeof(frame_t));
+		else
+			frame_set_4(pol_frame(hd), DPT_SELF_ADDR, DPT_SELF_ADDR, FR_CONTAINER, 0, 0, 0, 0, nb);
+		FIFO_put(&mnt.out_fifo[lane], &hd);
+		mnt.seq_i++;
+	}
+
+	// the same container can be entered again
+	mnt.seq_nb = 0;
+
+	return prf_try(q, OK);
+}
+
+// get the next frame to send, the high lane first
+static u8 mnt_out_get(pol_t* hd)
+{
+	if ( OK == FIFO_get(&mnt.out_fifo[MNT_HIGH], hd) )
+		return OK;
+
+	return FIFO_get(&mnt.out_fifo[MNT_LOW], hd);
+}
+
+// start the vertical velocity estimation from the take-off edge
+// the samples since the edge are gone, so the integration starts
+// at the sequence number of the sample matching the edge
+// and the first step counts them at the value of the latest one:
+// the error is at most the acceleration span over the detection delay,
+// the gap is bounded so the sequence difference does not wrap
+static void mnt_apogee_start(void)
+{
+	acq_acc_t acc;
+	u32 gap;
+
+	gap = (tmb_now_us() - mnt.take_off_time) / (TMB_1_SEC / ACQ_RATE);
+	if ( gap > DEPLOY_GAP )
+		gap = DEPLOY_GAP;
+
+	mnt.acq_seq = ACQ_get(&acc) - (u8)gap;
+	mnt.vel = 0;
+	mnt.flight = 1;
+}
+
+// integrate the vertical acceleration, only integer operations per sample
+// the apogee is when the velocity falls to zero after the lockout
+static void mnt_apogee(void)
+{
+	acq_acc_t acc;
+	u8 seq;
+
+	seq = ACQ_get(&acc);
+	if ( seq == mnt.acq_seq )
+		return;
+
+	// the samples filtered together share the last value
+	mnt.vel += (s32)(ACC_VERTICAL(acc) - ACQ_1_G) * (u8)(seq - mnt.acq_seq);
+	mnt.acq_seq = seq;
+
+	if ( !tmb_elapsed(mnt.take_off_time + mnt.lockout * (TMB_1_SEC / 10)) || mnt.vel > 0 )
+		return;
+
+	// the apogee replaces the time-out
+	if ( OK == prf_try(PRF_Q_MNT_CMD_EV, RING_put(&mnt.cmd_ev, mnt_EV_TIME_OUT)) ) {
+		tmb_alarm_cancel(&mnt.time_out);
+		mnt.flight = 0;
+	}
+}
+
+// sample the door at the given rate from now
+static void mnt_door_rate(u32 rate)
+{
+	mnt.sampling_rate = rate;
+	mnt.door_sample = tmb_now_us() + rate;
+	tmb_alarm_set(&mnt.door, mnt.door_sample);
+}
+
+// a servo command is sent, the door is expected to move
+static void mnt_door_fast(void)
+{
+	mnt.door_cmd_time = tmb_now_us();
+	mnt.door_fast_end = mnt.door_cmd_time + SAMPLING_FAST;
+	mnt.door_fast = 1;
+	mnt_door_rate(SAMPLING_PERIOD);
+}
+
+// sample the door and generate an event on each change
+static void mnt_door_sample(void)
+{
+	u8 state = CONE & CONE_STATE_OPEN;
+
+	// the change is seen again at the next sample if the event can not be stored
+	if ( state != mnt.door_state && OK == prf_try(PRF_Q_MNT_CMD_EV, RING_put(&mnt.cmd_ev, state == CONE_STATE_OPEN ? mnt_EV_DOOR_OPEN : mnt_EV_DOOR_CLOSED)) ) {
+		mnt.door_state = state;
+		mnt.door_delay = tmb_now_us() - mnt.door_cmd_time;
+
+		// the expected change is done
+		mnt.sampling_rate = SAMPLING_START;
+		mnt.door_fast = 0;
+	}
+
+	// the end time is only tested during the window, a stale one would wrap after about 35 min
+	if ( mnt.door_fast && tmb_elapsed(mnt.door_fast_end) ) {
+		mnt.sampling_rate = SAMPLING_START;
+		mnt.door_fast = 0;
+	}
+
+	// the next sample, not in the past after a late wake-up
+	mnt.door_sample += mnt.sampling_rate;
+	if ( tmb_elapsed(mnt.door_sample) )
+		mnt.door_sample = tmb_now_us() + mnt.sampling_rate;
+	tmb_alarm_set(&mnt.door, mnt.door_sample);
+}
+
 // actions
 static u8 action_init(pt_t* pt, void* args)
 {
         (void)args;
 
-	frame_t fr;
-
 	PT_BEGIN(pt);
 
+	rec_log(REC_STATE, tmb_now_us(), mnt_ST_INIT, 0, 0);
+
 	// preset container #1
-	PT_WAIT_UNTIL(pt, frame_set_4(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_CONTAINER, 0, 0, 0, 0, 1)
-			&& OK == FIFO_put(&mnt.out_fifo, &fr)
-	);
+	PT_WAIT_UNTIL(pt, OK == mnt_container(1, MNT_LOW));
 
 	// time-out 1s
-	mnt.time_out = TIME_get() + 1 * TIME_1_SEC;
+	tmb_alarm_set(&mnt.time_out, tmb_now_us() + 1 * TMB_1_SEC);
 
 	PT_YIELD_WHILE(pt, OK);
 
@@ -195,17 +531,16 @@ static u8 action_para_opening(pt_t* pt, void* args)
 {
         (void)args;
 
-	frame_t fr;
-
 	PT_BEGIN(pt);
 
+	rec_log(REC_STATE, tmb_now_us(), mnt_ST_PARA_OPENING, 0, 0);
+
 	// preset container #2
-	PT_WAIT_UNTIL(pt, frame_set_4(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_CONTAINER, 0, 0, 0, 0, 2)
-			&& OK == FIFO_put(&mnt.out_fifo, &fr)
-	);
+	PT_WAIT_UNTIL(pt, OK == mnt_container(2, MNT_HIGH));
+	mnt_door_fast();
 
 	// time-out 5s
-	mnt.time_out = TIME_get() + 5 * TIME_1_SEC;
+	tmb_alarm_set(&mnt.time_out, tmb_now_us() + 5 * TMB_1_SEC);
 
 	PT_YIELD_WHILE(pt, OK);
 
@@ -216,17 +551,16 @@ static u8 action_para_closing(pt_t* pt, void* args)
 {
         (void)args;
 
-	frame_t fr;
-
 	PT_BEGIN(pt);
 
+	rec_log(REC_STATE, tmb_now_us(), mnt_ST_PARA_CLOSING, 0, 0);
+
 	// preset container #3
-	PT_WAIT_UNTIL(pt, frame_set_4(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_CONTAINER, 0, 0, 0, 0, 3)
-			&& OK == FIFO_put(&mnt.out_fifo, &fr)
-	);
+	PT_WAIT_UNTIL(pt, OK == mnt_container(3, MNT_HIGH));
+	mnt_door_fast();
 
 	// time-out 2s
-	mnt.time_out = TIME_get() + 2 * TIME_1_SEC;
+	tmb_alarm_set(&mnt.time_out, tmb_now_us() + 2 * TMB_1_SEC);
 
 	PT_YIELD_WHILE(pt, OK);
 
@@ -237,14 +571,15 @@ static u8 action_waiting(pt_t* pt, void* args)
 {
         (void)args;
 
-	frame_t fr;
-
 	PT_BEGIN(pt);
 
+	rec_log(REC_STATE, tmb_now_us(), mnt_ST_WAITING, 0, 0);
+
+	// the take-off detection and the flight need the accelerations
+	ACQ_enable(1);
+
 	// preset container #4
-	PT_WAIT_UNTIL(pt, frame_set_4(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_CONTAINER, 0, 0, 0, 0, 4)
-			&& OK == FIFO_put(&mnt.out_fifo, &fr)
-	);
+	PT_WAIT_UNTIL(pt, OK == mnt_container(4, MNT_LOW));
 
 	PT_YIELD_WHILE(pt, OK);
 
@@ -255,17 +590,22 @@ static u8 action_flight(pt_t* pt, void* args)
 {
         (void)args;
 
-	frame_t fr;
-
 	PT_BEGIN(pt);
 
+	rec_log(REC_STATE, tmb_now_us(), mnt_ST_FLIGHT, 0, 0);
+
 	// preset container #5
-	PT_WAIT_UNTIL(pt, frame_set_4(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_CONTAINER, 0, 0, 0, 0, 5)
-			&& OK == FIFO_put(&mnt.out_fifo, &fr)
-	);
+	PT_WAIT_UNTIL(pt, OK == mnt_container(5, MNT_LOW));
 
-	// time-out = flight time
-	mnt.time_out = TIME_get() + mnt.open_time * TIME_1_SEC / 10;
+	// time-out = flight time counted from the take-off edge
+	// in apogee mode, it is the upper bound of the deployment
+	tmb_alarm_set(&mnt.time_out, mnt.take_off_time + mnt.open_time * (TMB_1_SEC / 10));
+
+	// the velocity is integrated from the take-off edge
+	mnt_apogee_start();
+
+	// no open command is sent yet
+	mnt.retries = 0;
 
 	PT_YIELD_WHILE(pt, OK);
 
@@ -276,37 +616,50 @@ static u8 action_parachute(pt_t* pt, void* args)
 {
         (void)args;
 
-	frame_t fr;
-
 	PT_BEGIN(pt);
 
+	mnt.flight = 0;
+
+	// the state is re-entered on each retry, it is only logged once
+	if ( mnt.retries == 0 )
+		rec_log(REC_STATE, tmb_now_us(), mnt_ST_PARACHUTE, 0, 0);
+
+	// the door level is read as an open change may not have been seen
+	// and the deployment goes on without the door sensor after the last retry
+	if ( (CONE & CONE_STATE_OPEN) == CONE_STATE_OPEN || mnt.retries > PARACHUTE_RETRIES ) {
+		PT_WAIT_UNTIL(pt, OK == prf_try(PRF_Q_MNT_CMD_EV, RING_put(&mnt.cmd_ev, mnt_EV_DEPLOYED)));
+		PT_YIELD_WHILE(pt, OK);
+	}
+	mnt.retries++;
+
 	// preset container #6
-	PT_WAIT_UNTIL(pt, frame_set_4(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_CONTAINER, 0, 0, 0, 0, 6)
-			&& OK == FIFO_put(&mnt.out_fifo, &fr)
-	);
+	PT_WAIT_UNTIL(pt, OK == mnt_container(6, MNT_HIGH));
+	mnt_door_fast();
+
+	// the door shall be seen open before the retry
+	tmb_alarm_set(&mnt.time_out, tmb_now_us() + PARACHUTE_RETRY);
 
 	PT_YIELD_WHILE(pt, OK);
 
 	PT_END(pt);
 }
 
-// check a time-out has elapsed
-static PT_THREAD( mnt_check_time_out(pt_t* pt) )
+static u8 action_deployed(pt_t* pt, void* args)
 {
-	mnt_event_t ev;
+        (void)args;
 
 	PT_BEGIN(pt);
 
-	// if current time is higher than the time-out target time
-	PT_WAIT_UNTIL(pt, TIME_get() > mnt.time_out);
-
-	// prevent any further time-out
-	mnt.time_out = TIME_MAX;
+	// the door is open or the retries are exhausted
+	mnt.unconfirmed = (CONE & CONE_STATE_OPEN) != CONE_STATE_OPEN;
+	rec_log(REC_STATE, tmb_now_us(), mnt_ST_DEPLOYED, mnt.retries, mnt.unconfirmed);
 
-	// generate the time-out event
-	PT_WAIT_UNTIL(pt, (ev = mnt_EV_TIME_OUT) && OK == FIFO_put(&mnt.ev_fifo, &ev) );
+	// the actuation time is available in mnt.door_delay
+	tmb_alarm_cancel(&mnt.time_out);
+	rec_sampling(0);
+	ACQ_enable(0);
 
-	PT_RESTART(pt);
+	PT_YIELD_WHILE(pt, OK);
 
 	PT_END(pt);
 }
@@ -324,6 +677,30 @@ static void mnt_open_time(frame_t* fr)
 			fr->argv[1] = mnt.open_time;
 			break;
 
+		case 0x01:
+			// save deployment mode and apogee lockout
+			if ( fr->argv[1] != DEPLOY_TIMER && fr->argv[1] != DEPLOY_APOGEE ) {
+				fr->error = 1;
+				break;
+			}
+			mnt.deploy = fr->argv[1];
+			mnt.lockout = fr->argv[2];
+			break;
+
+		case 0xfe:
+			// read deployment mode and apogee lockout
+			fr->argv[1] = mnt.deploy;
+			fr->argv[2] = mnt.lockout;
+			break;
+
+		case 0xfd:
+			// read door state, last actuation time [ms] and deployment without the door seen open
+			fr->argv[1] = mnt.door_state;
+			fr->argv[2] = (mnt.door_delay / TMB_1_MSEC) >> 8;
+			fr->argv[3] = (mnt.door_delay / TMB_1_MSEC) >> 0;
+			fr->argv[4] = mnt.unconfirmed;
+			break;
+
 		default:
 			// bad sub-command
 			fr->error = 1;
@@ -331,9 +708,31 @@ static void mnt_open_time(frame_t* fr)
 	}
 }
 
+static void mnt_take_off(frame_t* fr)
+{
+	u32 now = tmb_now_us();
+	u32 edge;
+
+	// the take-off detector provides the edge time stamp
+	edge = (u32)fr->argv[0] << 24;
+	edge |= (u32)fr->argv[1] << 16;
+	edge |= (u32)fr->argv[2] << 8;
+	edge |= (u32)fr->argv[3] << 0;
+
+	// a frame without a valid time stamp takes effect now
+	if ( edge == 0 || (s32)(edge - now) > 0 ) {
+		edge = now;
+	}
+
+	mnt.take_off_time = edge;
+
+	// the flight is recorded from the take-off
+	rec_log(REC_TAKE_OFF, edge, 0, 0, 0);
+	rec_sampling(1);
+}
+
 static PT_THREAD( mnt_check_commands(pt_t* pt) )
 {
-	mnt_event_t ev;
 	u8 swap;
 
 	PT_BEGIN(pt);
@@ -341,6 +740,16 @@ static PT_THREAD( mnt_check_commands(pt_t* pt) )
 	// as long as there are no command
 	PT_WAIT_UNTIL(pt, OK == FIFO_get(&mnt.in_fifo, &mnt.in_fr));
 
+	// the servo signals the end of its move by a second response
+	if ( mnt.in_fr.cmde == FR_MINUT_SERVO_CMD ) {
+		if ( mnt.started && mnt.in_fr.resp == 1 && mnt.in_fr.argv[3] == SERVO_DONE ) {
+			PT_WAIT_UNTIL(pt, OK == prf_try(PRF_Q_MNT_CMD_EV, RING_put(&mnt.cmd_ev, mnt_EV_SERVO_DONE)));
+		}
+
+		// the commands are handled by the servo
+		PT_RESTART(pt);
+	}
+
 	// silently ignore incoming response
 	if ( mnt.in_fr.resp == 1 ) {
 		//dpt_unlock(&mnt.interf);
@@ -349,8 +758,10 @@ static PT_THREAD( mnt_check_commands(pt_t* pt) )
 
 	switch (mnt.in_fr.cmde) {
 		case FR_TAKE_OFF:
+			mnt_take_off(&mnt.in_fr);
+
 			// generate take-off event
-			PT_WAIT_UNTIL(pt, (ev = mnt_EV_TAKE_OFF) && OK == FIFO_put(&mnt.ev_fifo, &ev) );
+			PT_WAIT_UNTIL(pt, OK == prf_try(PRF_Q_MNT_CMD_EV, RING_put(&mnt.cmd_ev, mnt_EV_TAKE_OFF)));
 			break;
 
 		case FR_MINUT_TIME_OUT:
@@ -369,6 +780,10 @@ static PT_THREAD( mnt_check_commands(pt_t* pt) )
 		case FR_APPLI_START:
 			mnt.started = 1;
 
+			// the door sampling events are only read once started
+			mnt.door_state = CONE & CONE_STATE_OPEN;
+			mnt_door_rate(SAMPLING_START);
+
 			// don't respond
 			PT_RESTART(pt);
 			break;
@@ -378,14 +793,20 @@ static PT_THREAD( mnt_check_commands(pt_t* pt) )
 			break;
 	}
 
-	// build the response to the current command
+	// build the response in place of the current command
 	swap = mnt.in_fr.orig;
 	mnt.in_fr.orig = mnt.in_fr.dest;
 	mnt.in_fr.dest = swap;
 	mnt.in_fr.resp = 1;
 
-	// enqueue it
-	PT_WAIT_UNTIL(pt, OK == FIFO_put(&mnt.out_fifo, &mnt.in_fr));
+	// send it, the interface is shared with the sending thread
+	// the pool is not needed so the commands never wait for the outgoing frames
+	PT_WAIT_UNTIL(pt, !mnt.sending);
+	mnt.sending = 1;
+	dpt_lock(&mnt.interf);
+	PT_WAIT_UNTIL(pt, OK == prf_try(PRF_Q_MNT_DPT, rte_tx(&mnt.interf, &mnt.in_fr)));
+	dpt_unlock(&mnt.interf);
+	mnt.sending = 0;
 
 	PT_RESTART(pt);
 
@@ -396,17 +817,28 @@ static PT_THREAD( mnt_send_frame(pt_t* pt) )
 {
 	PT_BEGIN(pt);
 
-	// wait until an outgoing frame is available
-	PT_WAIT_UNTIL(pt, OK == FIFO_get(&mnt.out_fifo, &mnt.out_fr));
+	// wait until an outgoing frame is available and the interface is free
+	PT_WAIT_UNTIL(pt, !mnt.sending && OK == mnt_out_get(&mnt.out_hd));
+	mnt.sending = 1;
 
 	// send the frame throught the dispatcher
 	dpt_lock(&mnt.interf);
+	mnt.burst = 0;
+
+	// the frames queued meanwhile are sent under the same lock
+	// up to a fifo length so the other modules are not starved
+	// a high lane frame queued during the burst is the next one sent
+	do {
+		// some retry may be needed
+		PT_WAIT_UNTIL(pt, OK == prf_try(PRF_Q_MNT_DPT, rte_tx(&mnt.interf, pol_frame(mnt.out_hd))));
 
-	// some retry may be needed
-	PT_WAIT_UNTIL(pt, OK == dpt_tx(&mnt.interf, &mnt.out_fr));
+		// the frame is copied by the dispatcher
+		pol_free(mnt.out_hd);
+	} while (++mnt.burst < NB_OUT_FR && OK == mnt_out_get(&mnt.out_hd));
 
 	// release the dispatcher
 	dpt_unlock(&mnt.interf);
+	mnt.sending = 0;
 
 	// loop back for the next frame to send
 	PT_RESTART(pt);
@@ -424,30 +856,55 @@ void mnt_init(void)
 	STM_init(&mnt.stm, &init);
 
 	// init fifoes
-	FIFO_init(&mnt.ev_fifo, mnt.ev_buf, NB_EVENTS, sizeof(mnt_event_t));
+	RING_init(&mnt.tmr_ev, mnt.tmr_ev_buf, NB_EVENTS);
+	RING_init(&mnt.cmd_ev, mnt.cmd_ev_buf, NB_EVENTS);
 	FIFO_init(&mnt.in_fifo, mnt.in_buf, NB_IN_FR, sizeof(frame_t));
-	FIFO_init(&mnt.out_fifo, mnt.out_buf, NB_OUT_FR, sizeof(frame_t));
+	FIFO_init(&mnt.out_fifo[MNT_HIGH], mnt.out_buf[MNT_HIGH], NB_OUT_FR, sizeof(pol_t));
+	FIFO_init(&mnt.out_fifo[MNT_LOW], mnt.out_buf[MNT_LOW], NB_OUT_FR, sizeof(pol_t));
 
 	// register to dispatcher
 	mnt.interf.channel = 7;
-	mnt.interf.cmde_mask = _CM(FR_TAKE_OFF) | _CM(FR_MINUT_TIME_OUT) | _CM(FR_STATE) | _CM(FR_APPLI_START);
+	mnt.interf.cmde_mask = _CM(FR_TAKE_OFF) | _CM(FR_MINUT_TIME_OUT) | _CM(FR_STATE) | _CM(FR_APPLI_START) | _CM(FR_MINUT_SERVO_CMD);
 	mnt.interf.queue = &mnt.in_fifo;
-	dpt_register(&mnt.interf);
+	rte_register(&mnt.interf);
 
 	// init threads
-	PT_INIT(&mnt.pt_chk_time_out);
 	PT_INIT(&mnt.pt_chk_cmds);
 	PT_INIT(&mnt.pt_out);
+	PT_INIT(&mnt.pt_flash);
 
-	// prevent any time-out
-	mnt.time_out = TIME_MAX;
+	// the time-out is posted by the timer2 interrupt
+	tmb_alarm_init(&mnt.time_out, &mnt.tmr_ev, mnt_EV_TIME_OUT);
 	mnt.sampling_rate = SAMPLING_START;
 
+	// the door samples are posted by the timer2 interrupt too
+	tmb_alarm_init(&mnt.door, &mnt.tmr_ev, mnt_EV_DOOR_SAMPLE);
+	mnt.door_delay = 0;
+	mnt.door_fast = 0;
+	mnt.retries = 0;
+	mnt.unconfirmed = 0;
+
+	// door sensor input with pull-up, the switch closes to ground
+	CONE_DDR &= ~_BV(CONE_PIN);
+	CONE_PORT |= _BV(CONE_PIN);
+
+	// the deployment is only timed until set otherwise
+	mnt.deploy = DEPLOY_TIMER;
+	mnt.lockout = DEPLOY_LOCKOUT;
+	mnt.flight = 0;
+
 	// the application start signal shall be received
 	mnt.started = 0;
+	mnt.sending = 0;
+
+	// the flash copy is checked once the eeprom is ready
+	mnt.flash = 0;
+	mnt.checked = 0;
+	mnt.seq_nb = 0;
+
 }
 
-void mnt_run(void)
+u8 mnt_run(void)
 {
 	// event sources are :
 	//  - take-off detector
@@ -455,30 +912,50 @@ void mnt_run(void)
 	//  - door detectors
 	//  - frame commands
 	//
-	//  each generated event is stored in a fifo
+	//  each generated event is stored in the ring of its producer
+	//  so the time-out is directly posted by the timer2 interrupt
 
-	if ( mnt.started ) {
-		// check if a time-out has elapsed
-		(void)PT_SCHEDULE(mnt_check_time_out(&mnt.pt_chk_time_out));
-	}
+	// the queues are the fullest when the dispatcher or the interrupts have just filled them
+	prf_queue(PRF_Q_MNT_IN, FIFO_full(&mnt.in_fifo));
+	prf_queue(PRF_Q_MNT_TMR_EV, RING_count(&mnt.tmr_ev));
+	prf_queue(PRF_Q_MNT_CMD_EV, RING_count(&mnt.cmd_ev));
 
 	// treat each incoming commands
 	(void)PT_SCHEDULE(mnt_check_commands(&mnt.pt_chk_cmds));
 
+	if ( !mnt.checked )
+		(void)PT_SCHEDULE(mnt_flash_check(&mnt.pt_flash));
+
 	if ( mnt.started ) {
 		// treat each new event
-		mnt_event_t ev;
+		u8 ev;
 
 		// if there is an event
-		if ( OK == FIFO_get(&mnt.ev_fifo, &ev) ) {
-			// send it to the state machine
-			STM_event(&mnt.stm, ev);
+		if ( OK == RING_get(&mnt.tmr_ev, &ev) || OK == RING_get(&mnt.cmd_ev, &ev) ) {
+			// the door samples only generate door events
+			if ( ev == mnt_EV_DOOR_SAMPLE )
+				mnt_door_sample();
+			else
+				// send it to the state machine
+				STM_event(&mnt.stm, ev);
 		}
 
 		// update state machine
 		STM_run(&mnt.stm);
+
+		// the apogee is estimated during the flight
+		if ( mnt.flight && mnt.deploy == DEPLOY_APOGEE )
+			mnt_apogee();
 	}
 
 	// send outgoing frame(s) if any
+	prf_queue(PRF_Q_MNT_OUT_HIGH, FIFO_full(&mnt.out_fifo[MNT_HIGH]));
+	prf_queue(PRF_Q_MNT_OUT_LOW, FIFO_full(&mnt.out_fifo[MNT_LOW]));
 	(void)PT_SCHEDULE(mnt_send_frame(&mnt.pt_out));
+
+	// the time-out alarm wakes the cpu up
+	// so only pending frames or events keep the module awake
+	return ( FIFO_full(&mnt.in_fifo) || FIFO_full(&mnt.out_fifo[MNT_HIGH]) || FIFO_full(&mnt.out_fifo[MNT_LOW]) || mnt.sending
+			|| (mnt.started && (RING_count(&mnt.tmr_ev) || RING_count(&mnt.cmd_ev)))
+			|| (!mnt.checked && EEP_is_fini()) );
 }
@@ -1,6 +1,8 @@
 #ifndef __MINUT_H__
 # define __MINUT_H__
 
+#include "type_def.h"
+
 
 // ------------------------------------------
 // public functions
@@ -9,6 +11,7 @@
 // the task detecting the take-off and opening the parachute
 extern void mnt_init(void);
 
-extern void mnt_run(void);
+// return non-zero while some work is pending
+extern u8 mnt_run(void);
 
 #endif	// __MINUT_H__
@@ -23,6 +23,9 @@ SERVO_OFF = 0x0f
 # time-out
 TIME_OUT_SAVE = 0x00
 
+# take-off
+TAKE_OFF_ACC_SAVE = 0x01
+
 # state
 STATE_GET = 0x9e
 STATE_SET = 0x5e
@@ -62,6 +65,9 @@ slots = [
 		# set flight time-out: 8.5s
 		minut_time_out(I2C_SELF_ADDR, I2C_SELF_ADDR, T_ID, CMD, TIME_OUT_SAVE, 85),
 
+		# set take-off acceleration: 3g during 10ms with the pin, 500ms without
+		take_off_thres(I2C_SELF_ADDR, I2C_SELF_ADDR, T_ID, CMD, TAKE_OFF_ACC_SAVE, 30, 10, 50),
+
 		# send application start signal
 		appli_start(I2C_SELF_ADDR, I2C_SELF_ADDR, T_ID, CMD),
 	],
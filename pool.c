@@ -0,0 +1,68 @@
+#include "pool.h"
+#include "prof.h"
+
+#include "avr/io.h"
+
+// every frame is allocated and freed from the main loop
+// so no protection against interrupts is needed
+
+// ------------------------------------------
+// private definitions
+//
+
+#define POL_NB          6       // shall not exceed the width of the used mask
+#define POL_RESERVED    2       // frames only given to high priority allocations
+
+
+// ------------------------------------------
+// private variables
+//
+
+struct {
+        frame_t fr[POL_NB];     // frames storage
+        u8 used;                // a bit set per allocated frame
+        u8 nb;                  // number of allocated frames
+} pol;
+
+
+// ------------------------------------------
+// public functions
+//
+
+void pol_init(void)
+{
+        pol.used = 0;
+        pol.nb = 0;
+}
+
+u8 pol_alloc(pol_t* hd, pol_prio_t prio)
+{
+        u8 i;
+
+        if (prio == POL_LOW && pol.nb >= POL_NB - POL_RESERVED)
+                return prf_try(PRF_Q_POOL, KO);
+
+        for (i = 0; i < POL_NB; i++) {
+                if (!(pol.used & _BV(i))) {
+                        pol.used |= _BV(i);
+                        pol.nb++;
+                        prf_queue(PRF_Q_POOL, pol.nb);
+                        *hd = i;
+
+                        return prf_try(PRF_Q_POOL, OK);
+                }
+        }
+
+        return prf_try(PRF_Q_POOL, KO);
+}
+
+frame_t* pol_frame(pol_t hd)
+{
+        return &pol.fr[hd];
+}
+
+void pol_free(pol_t hd)
+{
+        pol.used &= ~_BV(hd);
+        pol.nb--;
+}
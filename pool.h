@@ -0,0 +1,41 @@
+#ifndef __POOL_H__
+# define __POOL_H__
+
+#include "type_def.h"
+#include "dispatcher.h"
+
+
+// ------------------------------------------
+// public types
+//
+
+// handle on a frame of the pool
+typedef u8 pol_t;
+
+// allocation priorities
+// the low priority allocations leave some frames to the high priority ones
+// so cosmetic traffic can not starve the take-off and actuation frames
+typedef enum {
+        POL_HIGH,
+        POL_LOW,
+} pol_prio_t;
+
+
+// ------------------------------------------
+// public functions
+//
+
+// frame pool shared by the application modules
+// the fifos between the modules carry handles instead of frames
+extern void pol_init(void);
+
+// get a free frame of the given priority, return KO if none is available
+extern u8 pol_alloc(pol_t* hd, pol_prio_t prio);
+
+// access the frame of the given handle
+extern frame_t* pol_frame(pol_t hd);
+
+// give the frame back to the pool
+extern void pol_free(pol_t hd);
+
+#endif	// __POOL_H__
@@ -0,0 +1,642 @@
+#include "prof.h"
+#include "pool.h"
+#include "route.h"
+#include "timebase.h"
+#include "ring.h"
+
+#include "dispatcher.h"
+
+
+#include "utils/pt.h"
+#include "utils/fifo.h"
+
+#include "avr/io.h"
+#include "util/atomic.h"
+
+// each section keeps its min, max and mean durations
+// they are read and reset with the FR_CPU command
+//
+// a section run by the main loop is only updated by the main loop
+// and an interrupt section by its interrupt
+//
+// the stress mode sends echo frames to itself throught the dispatcher
+// at a given rate, their round trip is accounted as the PRF_STRESS section
+
+// ------------------------------------------
+// private definitions
+//
+
+#define IN_FIFO_SIZE    1
+#define EV_RING_SIZE    1
+
+#define PRF_EV_STRESS   0x01
+
+// FR_CPU sub-commands argv[0], the section is argv[1]
+#define PRF_MIN_MAX     0x00    // argv[2..3] min, argv[4..5] max [timer1 count]
+#define PRF_MEAN        0x01    // argv[2..3] mean [timer1 count], argv[4..5] runs number
+#define PRF_RESET       0xff    // reset the section, every one if 0xff
+
+#define PRF_ALL         0xff
+
+// FR_CPU memory sub-commands argv[0]
+#define PRF_RAM         0x20    // argv[2..3] static size, argv[4..5] stack peak [byte]
+#define PRF_QUEUE       0x21    // queue argv[1], argv[4] peak occupancy
+#define PRF_DROPS       0x22    // queue argv[1], argv[2..3] drops, argv[4..5] retries
+#define PRF_STALLS      0x23    // queue argv[1], argv[4..5] stalls
+
+// FR_CPU stress sub-commands argv[0]
+#define PRF_STRESS_SET  0x30    // argv[1] period [ms] or 0 to stop, argv[2] frames per period
+#define PRF_STRESS_CNT  0x31    // argv[2..3] sent frames, argv[4..5] received echoes
+#define PRF_ECHO        0x32    // stress frame, argv[1] sequence, argv[2..5] sending time [us]
+
+// the free ram is painted at boot, the stack peak is where the paint is lost
+#define PRF_PAINT       0xc5
+
+#ifdef ISR_STATS
+// FR_CPU sub-commands argv[0], the source is argv[1] and the bin argv[2]
+// argv[4..5] is the bin count, or the max for the bin 0xff
+#define PRF_LATENCY     0x10
+#define PRF_JITTER      0x11
+
+#define PRF_BIN_MAX     0xff
+
+// linear histograms, the last bin gathers the longer values
+#define PRF_BINS        8
+#define PRF_BIN_SHIFT   1       // bin width is 2 counts
+#endif
+
+
+// ------------------------------------------
+// private types
+//
+
+typedef struct {
+        u16 min;
+        u16 max;
+        u32 sum;                // durations sum
+        u16 nb;                 // runs number
+} prf_stat_t;
+
+// queue flow counters, saturated
+typedef struct {
+        u16 drop;               // lost elements
+        u16 retry;              // failed attempts
+        u16 stall;              // sequences of failed attempts
+        u8 blocked;             // the latest attempt failed
+} prf_flow_t;
+
+#ifdef ISR_STATS
+typedef struct {
+        u16 bin[PRF_BINS];      // saturated counts
+        u16 max;
+} prf_hist_t;
+#endif
+
+
+// ------------------------------------------
+// private variables
+//
+
+struct {
+        pt_t pt;                        // commands thread
+        dpt_interface_t interf;         // interface to the dispatcher
+
+        frame_t in_buf[IN_FIFO_SIZE];   // incoming commands fifo
+        fifo_t in_fifo;
+        frame_t in_fr;                  // command being handled, not from the pool so the fifo always drains
+
+        prf_stat_t stat[PRF_NB];
+        volatile u16 isr;               // interrupts time, free running
+
+        u8 queue[PRF_Q_NB];             // queues peak occupancy
+        prf_flow_t flow[PRF_Q_NB];      // queues flow counters
+
+        // stress mode
+        pt_t pt_stress;                 // stress frames thread
+        tmb_alarm_t alarm;              // stress periods alarm
+        ring_t ev;                      // stress periods events posted by the timer2 interrupt
+        u8 ev_buf[EV_RING_SIZE];
+        u32 period;                     // stress period [us], 0 when stopped
+        u32 time;                       // next period time
+        u8 nb;                          // frames per period
+        u8 i;                           // frame index in the period
+        u8 seq;                         // sequence of the frames
+        u8 bursting;                    // the frames of a period are being sent
+        pol_t stress_hd;                // pool frame of the stress frame
+        u16 sent;                       // stress frames sent
+        u16 received;                   // echoes received
+
+#ifdef ISR_STATS
+        prf_hist_t lat[PRF_LAT_NB];     // latency histograms
+        prf_hist_t jit[PRF_LAT_NB];     // jitter histograms, latency change from the previous interrupt
+        u16 prev[PRF_LAT_NB];           // previous latency
+#endif
+
+        u8 sending;                     // a frame is waiting for the dispatcher
+} prf;
+
+
+#ifdef ISR_STATS
+volatile u8 prf_lat[PRF_LAT_NB];
+#endif
+
+
+// bounds of the ram free at boot, from the linker
+extern u8 _end;
+extern u8 __stack;
+
+// paint the ram between the static variables and the stack top
+// it runs before the stack is set up so it shall not use it
+void prf_paint(void) __attribute__((naked, used, section(".init1")));
+
+void prf_paint(void)
+{
+        u8* p;
+
+        for (p = &_end; p <= &__stack; p++)
+                *p = PRF_PAINT;
+}
+
+
+// ------------------------------------------
+// private functions
+//
+
+// saturated increment
+static void prf_inc(u16* cnt)
+{
+        if (*cnt != 0xffff)
+                (*cnt)++;
+}
+
+// account a duration in a section statistics
+static void prf_account(prf_stat_t* st, u16 val)
+{
+        if (val < st->min)
+                st->min = val;
+        if (val > st->max)
+                st->max = val;
+
+        // the mean is kept on the latest runs
+        if (st->nb == 0xffff) {
+                st->sum >>= 1;
+                st->nb >>= 1;
+        }
+        st->sum += val;
+        st->nb++;
+}
+
+// deepest stack use since boot
+static u16 prf_stack(void)
+{
+        u8* p = &_end;
+
+        // the interrupts may push some bytes over the scan
+        while (p <= &__stack && *p == PRF_PAINT)
+                p++;
+
+        return &__stack - p + 1;
+}
+
+#ifdef ISR_STATS
+static void prf_hist(prf_hist_t* h, u16 val)
+{
+        u16 bin = val >> PRF_BIN_SHIFT;
+
+        if (bin >= PRF_BINS)
+                bin = PRF_BINS - 1;
+        if (h->bin[bin] != 0xffff)
+                h->bin[bin]++;
+        if (val > h->max)
+                h->max = val;
+}
+
+static void prf_hist_read(frame_t* fr)
+{
+        prf_hist_t* h;
+        u16 val;
+
+        if (fr->argv[1] >= PRF_LAT_NB || (fr->argv[2] >= PRF_BINS && fr->argv[2] != PRF_BIN_MAX)) {
+                fr->error = 1;
+                return;
+        }
+
+        h = fr->argv[0] == PRF_LATENCY ? &prf.lat[fr->argv[1]] : &prf.jit[fr->argv[1]];
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                val = fr->argv[2] == PRF_BIN_MAX ? h->max : h->bin[fr->argv[2]];
+        }
+
+        fr->argv[4] = val >> 8;
+        fr->argv[5] = val >> 0;
+}
+
+static void prf_hist_reset(void)
+{
+        u8 i;
+        u8 j;
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                for (i = 0; i < PRF_LAT_NB; i++) {
+                        for (j = 0; j < PRF_BINS; j++) {
+                                prf.lat[i].bin[j] = 0;
+                                prf.jit[i].bin[j] = 0;
+                        }
+                        prf.lat[i].max = 0;
+                        prf.jit[i].max = 0;
+                        prf.prev[i] = 0;
+                }
+        }
+}
+#endif
+
+static void prf_reset(u8 id)
+{
+        prf_stat_t* st = &prf.stat[id];
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                st->min = 0xffff;
+                st->max = 0;
+                st->sum = 0;
+                st->nb = 0;
+        }
+}
+
+static void prf_flow_reset(void)
+{
+        u8 i;
+
+        // some queues are accounted by the interrupts
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                for (i = 0; i < PRF_Q_NB; i++) {
+                        prf.queue[i] = 0;
+                        prf.flow[i].drop = 0;
+                        prf.flow[i].retry = 0;
+                        prf.flow[i].stall = 0;
+                        prf.flow[i].blocked = 0;
+                }
+        }
+}
+
+static void prf_flow_read(frame_t* fr)
+{
+        prf_flow_t flow;
+
+        if (fr->argv[1] >= PRF_Q_NB) {
+                fr->error = 1;
+                return;
+        }
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                flow = prf.flow[fr->argv[1]];
+        }
+
+        if (fr->argv[0] == PRF_DROPS) {
+                fr->argv[2] = flow.drop >> 8;
+                fr->argv[3] = flow.drop >> 0;
+                fr->argv[4] = flow.retry >> 8;
+                fr->argv[5] = flow.retry >> 0;
+        }
+        else {
+                fr->argv[4] = flow.stall >> 8;
+                fr->argv[5] = flow.stall >> 0;
+        }
+}
+
+// start or stop the stress mode, its counters are reset
+static void prf_stress_set(frame_t* fr)
+{
+        prf.period = (u32)fr->argv[1] * TMB_1_MSEC;
+        prf.nb = fr->argv[2];
+        prf.sent = 0;
+        prf.received = 0;
+        prf_reset(PRF_STRESS);
+
+        if (prf.period) {
+                prf.time = tmb_now_us() + prf.period;
+                tmb_alarm_set(&prf.alarm, prf.time);
+        }
+        else {
+                tmb_alarm_cancel(&prf.alarm);
+        }
+}
+
+// account the round trip of a stress frame
+static void prf_echo(frame_t* fr)
+{
+        u32 lat;
+
+        lat = tmb_now_us() - (((u32)fr->argv[2] << 24) | ((u32)fr->argv[3] << 16) | ((u32)fr->argv[4] << 8) | fr->argv[5]);
+        prf_account(&prf.stat[PRF_STRESS], lat > 0xffff ? 0xffff : lat);
+        prf_inc(&prf.received);
+}
+
+static void prf_read(frame_t* fr)
+{
+        prf_stat_t st;
+        u16 mean;
+        u16 val;
+        u8 i;
+
+        if (fr->argv[0] == PRF_RESET && fr->argv[1] == PRF_ALL) {
+                for (i = 0; i < PRF_NB; i++)
+                        prf_reset(i);
+                prf_flow_reset();
+#ifdef ISR_STATS
+                prf_hist_reset();
+#endif
+                return;
+        }
+
+        if (fr->argv[0] == PRF_RAM) {
+                val = &_end - (u8*)RAMSTART;
+                fr->argv[2] = val >> 8;
+                fr->argv[3] = val >> 0;
+                val = prf_stack();
+                fr->argv[4] = val >> 8;
+                fr->argv[5] = val >> 0;
+                return;
+        }
+
+        if (fr->argv[0] == PRF_QUEUE) {
+                if (fr->argv[1] >= PRF_Q_NB)
+                        fr->error = 1;
+                else
+                        fr->argv[4] = prf.queue[fr->argv[1]];
+                return;
+        }
+
+        if (fr->argv[0] == PRF_DROPS || fr->argv[0] == PRF_STALLS) {
+                prf_flow_read(fr);
+                return;
+        }
+
+        switch (fr->argv[0]) {
+        case PRF_STRESS_SET:
+                prf_stress_set(fr);
+                return;
+
+        case PRF_STRESS_CNT:
+                fr->argv[2] = prf.sent >> 8;
+                fr->argv[3] = prf.sent >> 0;
+                fr->argv[4] = prf.received >> 8;
+                fr->argv[5] = prf.received >> 0;
+                return;
+
+        case PRF_ECHO:
+                // sent back as is
+                return;
+        }
+
+#ifdef ISR_STATS
+        if (fr->argv[0] == PRF_LATENCY || fr->argv[0] == PRF_JITTER) {
+                prf_hist_read(fr);
+                return;
+        }
+#endif
+
+        if (fr->argv[1] >= PRF_NB) {
+                fr->error = 1;
+                return;
+        }
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                st = prf.stat[fr->argv[1]];
+        }
+
+        switch (fr->argv[0]) {
+        case PRF_MIN_MAX:
+                fr->argv[2] = st.min >> 8;
+                fr->argv[3] = st.min >> 0;
+                fr->argv[4] = st.max >> 8;
+                fr->argv[5] = st.max >> 0;
+                break;
+
+        case PRF_MEAN:
+                mean = st.nb ? st.sum / st.nb : 0;
+                fr->argv[2] = mean >> 8;
+                fr->argv[3] = mean >> 0;
+                fr->argv[4] = st.nb >> 8;
+                fr->argv[5] = st.nb >> 0;
+                break;
+
+        case PRF_RESET:
+                prf_reset(fr->argv[1]);
+                break;
+
+        default:
+                // bad sub-command
+                fr->error = 1;
+                break;
+        }
+}
+
+static PT_THREAD( prf_thread(pt_t* pt) )
+{
+        u8 swap;
+
+        PT_BEGIN(pt);
+
+        // wait incoming commands
+        PT_WAIT_UNTIL(pt, OK == FIFO_get(&prf.in_fifo, &prf.in_fr));
+
+        // response is ignored but the stress echoes
+        if (prf.in_fr.resp) {
+                if (prf.in_fr.argv[0] == PRF_ECHO)
+                        prf_echo(&prf.in_fr);
+                PT_RESTART(pt);
+        }
+
+        prf.in_fr.error = 0;
+        prf_read(&prf.in_fr);
+
+        // send the response
+        swap = prf.in_fr.orig;
+        prf.in_fr.orig = prf.in_fr.dest;
+        prf.in_fr.dest = swap;
+        prf.in_fr.resp = 1;
+
+        // the interface is shared with the stress thread
+        PT_WAIT_UNTIL(pt, !prf.sending);
+        prf.sending = 1;
+        dpt_lock(&prf.interf);
+        PT_WAIT_UNTIL(pt, OK == prf_try(PRF_Q_PRF_DPT, rte_tx(&prf.interf, &prf.in_fr)));
+        dpt_unlock(&prf.interf);
+        prf.sending = 0;
+
+        PT_RESTART(pt);
+
+        PT_END(pt);
+}
+
+static PT_THREAD( prf_stress(pt_t* pt) )
+{
+        frame_t* fr;
+        u32 now;
+        u8 ev;
+
+        PT_BEGIN(pt);
+
+        // wait the next period
+        PT_WAIT_UNTIL(pt, OK == RING_get(&prf.ev, &ev));
+        if (!prf.period)
+                PT_RESTART(pt);
+
+        // a late period is not caught up, the next one is not in the past
+        prf.time += prf.period;
+        if (tmb_elapsed(prf.time))
+                prf.time = tmb_now_us() + prf.period;
+        tmb_alarm_set(&prf.alarm, prf.time);
+
+        prf.bursting = 1;
+        for (prf.i = 0; prf.i < prf.nb && prf.period; prf.i++) {
+                PT_WAIT_UNTIL(pt, !prf.sending && OK == pol_alloc(&prf.stress_hd, POL_LOW));
+
+                now = tmb_now_us();
+                fr = pol_frame(prf.stress_hd);
+                frame_set_6(fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_CPU, 0,
+                                PRF_ECHO, prf.seq++, now >> 24, now >> 16, now >> 8, now >> 0);
+
+                prf.sending = 1;
+                dpt_lock(&prf.interf);
+                PT_WAIT_UNTIL(pt, OK == prf_try(PRF_Q_PRF_DPT, rte_tx(&prf.interf, pol_frame(prf.stress_hd))));
+                dpt_unlock(&prf.interf);
+                prf.sending = 0;
+
+                // the frame is copied by the dispatcher
+                pol_free(prf.stress_hd);
+                prf_inc(&prf.sent);
+        }
+        prf.bursting = 0;
+
+        PT_RESTART(pt);
+
+        PT_END(pt);
+}
+
+
+// ------------------------------------------
+// public functions
+//
+
+void prf_init(void)
+{
+        u8 i;
+
+        FIFO_init(&prf.in_fifo, &prf.in_buf, IN_FIFO_SIZE, sizeof(frame_t));
+
+        // the scalp cpu module is not used, so its command is taken
+        prf.interf.channel = 9;
+        prf.interf.cmde_mask = _CM(FR_CPU);
+        prf.interf.queue = &prf.in_fifo;
+        rte_register(&prf.interf);
+
+        for (i = 0; i < PRF_NB; i++)
+                prf_reset(i);
+        prf_flow_reset();
+#ifdef ISR_STATS
+        prf_hist_reset();
+#endif
+        prf.isr = 0;
+        PRF_SECTION = 0;
+
+        // the stress periods are posted by the timer2 interrupt
+        RING_init(&prf.ev, prf.ev_buf, EV_RING_SIZE);
+        tmb_alarm_init(&prf.alarm, &prf.ev, PRF_EV_STRESS);
+        prf.period = 0;
+        prf.bursting = 0;
+
+        prf.sending = 0;
+
+        PT_INIT(&prf.pt);
+        PT_INIT(&prf.pt_stress);
+}
+
+
+u8 prf_run(void)
+{
+        (void)PT_SCHEDULE(prf_thread(&prf.pt));
+        (void)PT_SCHEDULE(prf_stress(&prf.pt_stress));
+
+        return FIFO_full(&prf.in_fifo) || RING_count(&prf.ev) || prf.bursting || prf.sending;
+}
+
+
+void prf_enter(prf_mark_t* mark, u8 id)
+{
+        // the timer1 16 bits registers are shared with the interrupts
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                mark->cnt = TCNT1;
+                mark->isr = prf.isr;
+        }
+
+        mark->prev = PRF_SECTION;
+        PRF_SECTION = id + 1;
+}
+
+
+void prf_leave(prf_mark_t* mark, u8 id)
+{
+        u16 cnt;
+        u16 isr;
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                cnt = TCNT1 - mark->cnt;
+                isr = prf.isr - mark->isr;
+
+                // an interrupt is not interrupted, its time is removed from the main loop sections
+                if (id >= PRF_ISR_TMB)
+                        prf.isr += cnt;
+                else
+                        cnt -= isr;
+        }
+
+        PRF_SECTION = mark->prev;
+
+        prf_account(&prf.stat[id], cnt);
+}
+
+
+void prf_queue(u8 id, u8 nb)
+{
+        if (nb > prf.queue[id])
+                prf.queue[id] = nb;
+}
+
+
+u8 prf_try(u8 id, u8 status)
+{
+        prf_flow_t* flow = &prf.flow[id];
+
+        if (status == OK) {
+                flow->blocked = 0;
+                return OK;
+        }
+
+        prf_inc(&flow->retry);
+        if (!flow->blocked)
+                prf_inc(&flow->stall);
+        flow->blocked = 1;
+
+        return status;
+}
+
+
+void prf_drop(u8 id)
+{
+        prf_inc(&prf.flow[id].drop);
+}
+
+
+#ifdef ISR_STATS
+void prf_latency(u8 src, u16 lat)
+{
+        u16 jit = lat > prf.prev[src] ? lat - prf.prev[src] : prf.prev[src] - lat;
+
+        prf.prev[src] = lat;
+        prf_lat[src] = lat > 0xff ? 0xff : lat;
+
+        prf_hist(&prf.lat[src], lat);
+        prf_hist(&prf.jit[src], jit);
+}
+#endif
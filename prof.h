@@ -0,0 +1,130 @@
+#ifndef __PROF_H__
+# define __PROF_H__
+
+#include "type_def.h"
+
+
+// ------------------------------------------
+// public types
+//
+
+// measured sections
+typedef enum {
+        PRF_DPT,
+        PRF_BSC,
+        PRF_CMN,
+        PRF_MNT,
+        PRF_SRV,
+        PRF_TKF,
+        PRF_ACQ,
+        PRF_REC,
+        PRF_ISR_TMB,            // timer2 compare, time base
+        PRF_ISR_TMR1,           // timer1 capture and compares
+        PRF_STRESS,             // stress frames round trip [us], not a section
+        PRF_NB,
+} prf_id_t;
+
+// interrupts latency sources [0.5 us], ISR_STATS build option
+typedef enum {
+        PRF_LAT_TMB,            // timer2 compare
+        PRF_LAT_TMR1_CAPT,      // timer1 capture
+        PRF_LAT_TMR1_A,         // timer1 compare A
+        PRF_LAT_TMR1_B,         // timer1 compare B
+        PRF_LAT_NB,
+} prf_lat_id_t;
+
+// monitored queues
+typedef enum {
+        PRF_Q_MNT_IN,
+        PRF_Q_MNT_OUT_HIGH,
+        PRF_Q_MNT_OUT_LOW,
+        PRF_Q_MNT_TMR_EV,
+        PRF_Q_MNT_CMD_EV,
+        PRF_Q_SRV_IN,
+        PRF_Q_SRV_OUT,
+        PRF_Q_SRV_EV,
+        PRF_Q_TKF_IN,
+        PRF_Q_TKF_EV,
+        PRF_Q_ACQ_IN,
+        PRF_Q_POOL,
+        PRF_Q_REC,
+        PRF_Q_MNT_DPT,          // frames sent to the dispatcher by each module, no occupancy
+        PRF_Q_SRV_DPT,          // a module sends one frame at a time
+        PRF_Q_TKF_DPT,          // so its stalls are not mixed with the other ones
+        PRF_Q_ACQ_DPT,
+        PRF_Q_PRF_DPT,
+        PRF_Q_TMB,              // alarms events, no occupancy
+        PRF_Q_NB,
+} prf_queue_id_t;
+
+// start of a measure
+typedef struct {
+        u16 cnt;                // timer1 count
+        u16 isr;                // interrupts time
+        u8 prev;                // interrupted section
+} prf_mark_t;
+
+
+// ------------------------------------------
+// public definitions
+//
+
+// the running section + 1 is set in GPIOR1, 0 outside of any section
+// so the sections durations are visible in the vcd trace
+#define PRF_SECTION     GPIOR1
+
+// measure a module run
+#define PRF_RUN(id, call)                               \
+        do {                                            \
+                prf_mark_t mark;                        \
+                prf_enter(&mark, (id));                 \
+                call;                                   \
+                prf_leave(&mark, (id));                 \
+        } while (0)
+
+
+#ifdef ISR_STATS
+// latest latency of each source [0.5 us], saturated
+// traced in the vcd
+extern volatile u8 prf_lat[PRF_LAT_NB];
+#endif
+
+
+// ------------------------------------------
+// public functions
+//
+
+// the durations are counted by the free running timer1 (8 cpu cycles per count)
+// the time base and timer1 interrupts time is not accounted in the interrupted module
+// but the TWI, UART and eeprom interrupts are vectored in the support library
+// so their time is included in the section they interrupted
+extern void prf_init(void);
+
+// return non-zero while some work is pending
+extern u8 prf_run(void);
+
+extern void prf_enter(prf_mark_t* mark, u8 id);
+
+extern void prf_leave(prf_mark_t* mark, u8 id);
+
+// account the occupancy of a queue, only from the main loop
+extern void prf_queue(u8 id, u8 nb);
+
+// account an attempt to store in a queue and return its status
+// a failed attempt is a retry, the first one of a sequence is a stall
+// only from the main loop
+extern u8 prf_try(u8 id, u8 status);
+
+// account an element lost by a queue, from the main loop or an interrupt
+// but a queue shall be always accounted from the same context
+extern void prf_drop(u8 id);
+
+// account the latency of an interrupt [timer1 count]
+// shall be called first in the interrupt
+#ifdef ISR_STATS
+extern void prf_latency(u8 src, u16 lat);
+#else
+# define prf_latency(src, lat)
+#endif
+
+#endif	// __PROF_H__
@@ -0,0 +1,229 @@
+#include "rec.h"
+#include "acq.h"
+#include "timebase.h"
+#include "prof.h"
+
+#include "drivers/eeprom.h"
+
+#include "utils/pt.h"
+#include "utils/fifo.h"
+
+#include <avr/io.h>
+
+// the records are buffered in ram and written in batches to the eeprom
+// left free after the frames, the writes are done by the eeprom interrupt
+// so the callers never wait for them
+//
+// the area is a circular log: a new session goes on after the newest record
+// so each byte is written once per lap whatever the number of resets
+// a session never writes more records than the area holds
+// so it can not overwrite its own first records
+//
+// each record carries a sequence number incremented when it is written,
+// the newest record is the one before the first break in the sequence
+// read back with "scons eeprom_check"
+
+// ------------------------------------------
+// private definitions
+//
+
+#define REC_FIFO_SIZE   8
+#define REC_BATCH       2       // records per write, an eeprom byte takes 3.4 ms
+#define REC_DECIM       (ACQ_RATE / 2)          // accelerations recorded at 2 Hz, shall fit in u8
+#define REC_SAMPLING    (30 * TMB_1_SEC)        // longest accelerations recording, 60 records
+
+
+// ------------------------------------------
+// private types
+//
+
+typedef struct {
+        u8 seq;                 // write sequence
+        u8 type;
+        u8 time[3];             // [1.024 ms] from reset, msb first
+        u8 data[3];
+} rec_t;
+
+
+// ------------------------------------------
+// private variables
+//
+
+struct {
+        pt_t pt;                        // eeprom writing thread
+
+        fifo_t fifo;                    // records waiting for the eeprom
+        rec_t buf[REC_FIFO_SIZE];
+
+        rec_t batch[REC_BATCH];         // records being written, read by the eeprom interrupt
+        u8 nb;                          // number of records in the batch
+
+        u16 base;                       // area start address
+        u8 size;                        // area size [records]
+        u8 head;                        // next written record
+        u8 seq;                         // sequence of the next written record
+        u8 found;                       // the head is found, the records can be written
+        u8 logged;                      // records accepted in the session
+
+        u8 sampling;                    // the accelerations are recorded
+        u8 acq_seq;                     // sequence number of the last recorded acceleration
+        u32 sampling_end;
+
+} rec;
+
+// end of the frames in eeprom, from the linker
+extern u8 __eeprom_end;
+
+
+// ------------------------------------------
+// private functions
+//
+
+static u16 rec_addr(u8 i)
+{
+        return rec.base + i * sizeof(rec_t);
+}
+
+// record the vertical acceleration at a reduced rate
+static void rec_acc(void)
+{
+        acq_acc_t acc;
+        u8 seq;
+
+        seq = ACQ_get(&acc);
+        if ( (u8)(seq - rec.acq_seq) < REC_DECIM )
+                return;
+        rec.acq_seq = seq;
+
+        rec_log(REC_ACC, tmb_now_us(), ACC_VERTICAL(acc) >> 8, ACC_VERTICAL(acc) >> 0, 0);
+
+        if ( tmb_elapsed(rec.sampling_end) )
+                rec.sampling = 0;
+}
+
+static PT_THREAD( rec_flush(pt_t* pt) )
+{
+        u8 seq;
+
+        PT_BEGIN(pt);
+
+        // find where the previous session stopped
+        // a read is refused while the eeprom is written, so it is retried
+        // rec.seq holds the previous sequence and rec.head the index
+        if (!rec.found) {
+                PT_WAIT_UNTIL(pt, OK == EEP_read(rec_addr(0), &rec.seq, 1));
+                for (rec.head = 1; rec.head < rec.size; rec.head++) {
+                        PT_WAIT_UNTIL(pt, OK == EEP_read(rec_addr(rec.head), &seq, 1));
+                        if (seq != (u8)(rec.seq + 1))
+                                break;
+                        rec.seq = seq;
+                }
+
+                // without any break, the newest record is the last one of the area
+                if (rec.head >= rec.size)
+                        rec.head = 0;
+                rec.seq++;
+                rec.found = 1;
+        }
+
+        // the batch buffer is in use until the previous write is done
+        PT_WAIT_UNTIL(pt, FIFO_full(&rec.fifo) && EEP_is_fini());
+
+        // a batch does not wrap around the end of the area
+        for (rec.nb = 0; rec.nb < REC_BATCH && rec.head + rec.nb < rec.size; rec.nb++) {
+                if (KO == FIFO_get(&rec.fifo, &rec.batch[rec.nb]))
+                        break;
+                rec.batch[rec.nb].seq = rec.seq++;
+        }
+
+        PT_WAIT_UNTIL(pt, OK == EEP_write(rec_addr(rec.head), (u8*)rec.batch, rec.nb * sizeof(rec_t)));
+
+        rec.head += rec.nb;
+        if (rec.head >= rec.size)
+                rec.head = 0;
+
+        PT_RESTART(pt);
+
+        PT_END(pt);
+}
+
+
+// ------------------------------------------
+// public functions
+//
+
+void rec_init(void)
+{
+        FIFO_init(&rec.fifo, rec.buf, REC_FIFO_SIZE, sizeof(rec_t));
+
+        rec.base = (u16)&__eeprom_end;
+        rec.size = (E2END + 1 - rec.base) / sizeof(rec_t);
+        rec.found = 0;
+        rec.logged = 0;
+
+        rec.sampling = 0;
+
+        PT_INIT(&rec.pt);
+
+        // the flags are cleared so the next reset cause is not mixed with this one
+        rec_log(REC_BOOT, tmb_now_us(), MCUSR, 0, 0);
+        MCUSR = 0;
+}
+
+
+u8 rec_run(void)
+{
+        prf_queue(PRF_Q_REC, FIFO_full(&rec.fifo));
+
+        if (rec.sampling)
+                rec_acc();
+
+        // the frames fill the whole eeprom
+        if (rec.size)
+                (void)PT_SCHEDULE(rec_flush(&rec.pt));
+
+        // the eeprom interrupt wakes the cpu up at the end of a write
+        return rec.size && (!rec.found || FIFO_full(&rec.fifo)) && EEP_is_fini();
+}
+
+
+void rec_log(u8 type, u32 time, u8 d0, u8 d1, u8 d2)
+{
+        rec_t r;
+
+        // the frames fill the whole eeprom
+        if (!rec.size)
+                return;
+
+        // the area is full of the session records
+        if (rec.logged >= rec.size) {
+                prf_drop(PRF_Q_REC);
+                return;
+        }
+
+        time >>= 10;
+        r.type = type;
+        r.time[0] = time >> 16;
+        r.time[1] = time >> 8;
+        r.time[2] = time >> 0;
+        r.data[0] = d0;
+        r.data[1] = d1;
+        r.data[2] = d2;
+
+        // the sequence is only given when written so a lost record leaves no gap
+        if (KO == FIFO_put(&rec.fifo, &r)) {
+                prf_drop(PRF_Q_REC);
+                return;
+        }
+        rec.logged++;
+}
+
+
+void rec_sampling(u8 on)
+{
+        acq_acc_t acc;
+
+        rec.sampling = on;
+        rec.acq_seq = ACQ_get(&acc);
+        rec.sampling_end = tmb_now_us() + REC_SAMPLING;
+}
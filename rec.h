@@ -0,0 +1,39 @@
+#ifndef __REC_H__
+# define __REC_H__
+
+#include "type_def.h"
+
+
+// ------------------------------------------
+// public types
+//
+
+// recorded events
+typedef enum {
+        REC_BOOT,               // reset cause (MCUSR)
+        REC_STATE,              // entered state, deployed: open commands sent, door unconfirmed
+        REC_TAKE_OFF,           // at the take-off edge time
+        REC_SERVO_CMD,          // servo id, sense, error
+        REC_SERVO_DONE,         // servo id, status, position feedback
+        REC_ACC,                // vertical acceleration msb, lsb [ACQ_1_G]
+} rec_type_t;
+
+
+// ------------------------------------------
+// public functions
+//
+
+// flight recorder in the eeprom left free by the frames
+extern void rec_init(void);
+
+// return non-zero while some work is pending
+extern u8 rec_run(void);
+
+// record an event at the given time [us], it never blocks
+// the event is lost if the ram buffer is full
+extern void rec_log(u8 type, u32 time, u8 d0, u8 d1, u8 d2);
+
+// record the acceleration samples or stop it
+extern void rec_sampling(u8 on);
+
+#endif	// __REC_H__
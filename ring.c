@@ -0,0 +1,57 @@
+#include "ring.h"
+
+// the indexes are single bytes, so their accesses are atomic on AVR
+// the element is written (read) before the head (tail) is updated
+// and a compiler barrier prevents both accesses to be reordered
+
+// ------------------------------------------
+// private definitions
+//
+
+#define RING_BARRIER()  __asm__ __volatile__ ("" ::: "memory")
+
+
+// ------------------------------------------
+// public functions
+//
+
+void RING_init(ring_t* ring, u8* buf, u8 size)
+{
+        ring->buf = buf;
+        ring->mask = size - 1;
+        ring->head = 0;
+        ring->tail = 0;
+}
+
+u8 RING_put(ring_t* ring, u8 elem)
+{
+        u8 head = ring->head;
+
+        if ((u8)(head - ring->tail) > ring->mask)
+                return KO;
+
+        ring->buf[head & ring->mask] = elem;
+        RING_BARRIER();
+        ring->head = head + 1;
+
+        return OK;
+}
+
+u8 RING_get(ring_t* ring, u8* elem)
+{
+        u8 tail = ring->tail;
+
+        if (tail == ring->head)
+                return KO;
+
+        *elem = ring->buf[tail & ring->mask];
+        RING_BARRIER();
+        ring->tail = tail + 1;
+
+        return OK;
+}
+
+u8 RING_count(ring_t* ring)
+{
+        return ring->head - ring->tail;
+}
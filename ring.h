@@ -0,0 +1,39 @@
+#ifndef __RING_H__
+# define __RING_H__
+
+#include "type_def.h"
+
+
+// ------------------------------------------
+// public types
+//
+
+// single producer / single consumer ring of bytes
+//
+// the producer only writes the head index and the consumer the tail one
+// so each side can run in interrupt context without any lock
+typedef struct {
+        u8* buf;                // elements storage
+        u8 mask;                // size - 1, the size is a power of 2
+        volatile u8 head;       // next written element, free running
+        volatile u8 tail;       // next read element, free running
+} ring_t;
+
+
+// ------------------------------------------
+// public functions
+//
+
+// init the ring with the given buffer, size shall be a power of 2 up to 128
+extern void RING_init(ring_t* ring, u8* buf, u8 size);
+
+// producer side, return KO if the ring is full
+extern u8 RING_put(ring_t* ring, u8 elem);
+
+// consumer side, return KO if the ring is empty
+extern u8 RING_get(ring_t* ring, u8* elem);
+
+// number of elements in the ring
+extern u8 RING_count(ring_t* ring);
+
+#endif	// __RING_H__
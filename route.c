@@ -0,0 +1,116 @@
+#include "route.h"
+
+#include "utils/fifo.h"
+
+#include "avr/io.h"
+
+// every frame is sent from the main loop
+// so no protection against interrupts is needed
+
+// ------------------------------------------
+// private definitions
+//
+
+#define RTE_NB          8       // shall not exceed the width of the table entries
+#define RTE_CMDE_NB     64      // width of the interfaces command masks
+
+// commands only defined and handled by the application modules
+// the other ones may be taken by the dispatcher, the basic or the common modules
+// so they always go through the dispatcher
+#define RTE_APPLI       ( _CM(FR_TAKE_OFF) | _CM(FR_TAKE_OFF_THRES) | _CM(FR_MINUT_TIME_OUT) \
+                        | _CM(FR_MINUT_SERVO_CMD) | _CM(FR_MINUT_SERVO_INFO) | _CM(FR_CPU) )
+
+
+// ------------------------------------------
+// private variables
+//
+
+struct {
+        dpt_interface_t* interf[RTE_NB];        // registered application interfaces
+        u8 nb;                                  // number of registered interfaces
+        u8 table[RTE_CMDE_NB];                  // a bit per interface taking the command, 0 for the dispatcher
+        u8 sent;                                // some frame was sent since the last run
+} rte;
+
+
+// ------------------------------------------
+// public functions
+//
+
+void rte_init(void)
+{
+        u8 i;
+
+        for (i = 0; i < RTE_CMDE_NB; i++)
+                rte.table[i] = 0;
+        rte.nb = 0;
+        rte.sent = 0;
+}
+
+void rte_register(dpt_interface_t* interf)
+{
+        dpt_register(interf);
+
+        // an interface beyond the table leaves every frame to the dispatcher
+        if (rte.nb < RTE_NB)
+                rte.interf[rte.nb] = interf;
+        rte.nb++;
+}
+
+void rte_build(void)
+{
+        u8 i;
+        u8 cmde;
+
+        if (rte.nb > RTE_NB)
+                return;
+
+        for (i = 0; i < rte.nb; i++) {
+                for (cmde = 0; cmde < RTE_CMDE_NB; cmde++) {
+                        if ((RTE_APPLI & rte.interf[i]->cmde_mask) & _CM(cmde))
+                                rte.table[cmde] |= _BV(i);
+                }
+        }
+}
+
+u8 rte_tx(dpt_interface_t* interf, frame_t* fr)
+{
+        u8 dest = 0;
+        u8 i;
+
+        // as the dispatcher, every interface taking the command gets the frame
+        // the sender included
+        if (fr->dest == DPT_SELF_ADDR && fr->cmde < RTE_CMDE_NB)
+                dest = rte.table[fr->cmde];
+
+        if (!dest) {
+                if (KO == dpt_tx(interf, fr))
+                        return KO;
+
+                rte.sent = 1;
+                return OK;
+        }
+
+        // the frame is only sent if every queue can take it
+        for (i = 0; i < rte.nb; i++) {
+                if ((dest & _BV(i)) && !FIFO_free(rte.interf[i]->queue))
+                        return KO;
+        }
+
+        for (i = 0; i < rte.nb; i++) {
+                if (dest & _BV(i))
+                        FIFO_put(rte.interf[i]->queue, fr);
+        }
+
+        rte.sent = 1;
+        return OK;
+}
+
+u8 rte_run(void)
+{
+        u8 sent = rte.sent;
+
+        rte.sent = 0;
+
+        return sent;
+}
@@ -0,0 +1,33 @@
+#ifndef __ROUTE_H__
+# define __ROUTE_H__
+
+#include "type_def.h"
+#include "dispatcher.h"
+
+
+// ------------------------------------------
+// public functions
+//
+
+// local routing of the frames exchanged between the application modules
+//
+// the commands only handled by the application modules are looked up
+// in a table built once every interface is registered
+// instead of being scanned against every interface by the dispatcher
+extern void rte_init(void);
+
+// register the interface to the dispatcher and to the local table
+extern void rte_register(dpt_interface_t* interf);
+
+// build the table, to be called after the last registration
+extern void rte_build(void);
+
+// send the frame directly to the local interfaces taking its command
+// or through the dispatcher for any other frame
+// return KO if the frame can not be sent now
+extern u8 rte_tx(dpt_interface_t* interf, frame_t* fr);
+
+// return non-zero if some frame was sent since the last call
+extern u8 rte_run(void);
+
+#endif	// __ROUTE_H__
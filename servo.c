@@ -1,4 +1,10 @@
 #include "servo.h"
+#include "pool.h"
+#include "route.h"
+#include "timebase.h"
+#include "ring.h"
+#include "prof.h"
+#include "rec.h"
 
 #include "dispatcher.h"
 
@@ -8,6 +14,7 @@
 #include "utils/time.h"
 
 #include "avr/io.h"
+#include "util/atomic.h"
 
 
 // ------------------------------------------
@@ -16,11 +23,115 @@
 
 #define IN_FIFO_SIZE    3
 #define OUT_FIFO_SIZE   3
+#define EV_RING_SIZE    4
+#define FB_RING_SIZE    2
+
+#define SRV_EV_FB       0x01
+
+// motion profile parameters, FR_MINUT_SERVO_INFO argv[2]
+#define SRV_RAMP_SPEED  0x5e    // max speed [count / period], 0 to jump to the position
+#define SRV_RAMP_ACC    0xac    // acceleration [count / period^2], 0 for a constant speed
+
+// hold parameters, FR_MINUT_SERVO_INFO argv[2]
+#define SRV_HOLD        0x70    // powered time after the move [100 ms], 0 to hold for ever
+#define SRV_REFRESH     0x7e    // refresh pulse period once unpowered [100 ms], 0 for none
+
+#define SRV_SPEED       160     // default full travel (2000 counts) in about 0.4 s
+#define SRV_ACC         20
+#define SRV_HOLD_TIME   10      // default hold of 1 s
+#define SRV_REFRESH_TIME 10     // then a pulse per second
+
+#define SRV_PERIODS     5       // pwm periods in 100 ms
+
+// position feedback parameter, FR_MINUT_SERVO_INFO argv[2]
+#define SRV_FEEDBACK    0xfb    // 1 to wait for the potentiometer tap to settle, 0 for none
+
+// the position is settled when the tap stays in the tolerance for some samples
+#define SRV_FB_PERIOD   (2 * TMB_1_MSEC)
+#define SRV_FB_TOL      2       // [adc count]
+#define SRV_FB_STABLE   5       // [samples]
+#define SRV_FB_TIME_OUT (1 * TMB_1_SEC)
+
+// completion frame status, FR_MINUT_SERVO_CMD response argv[3]
+// argv[2] is the settled position [adc count], argv[4..5] the settle time [ms]
+#define SRV_ACK         0x00
+#define SRV_DONE        0xd0
+#define SRV_STALL       0xd5    // the position did not settle in time
+
+// servo identifiers, FR_MINUT_SERVO_CMD and FR_MINUT_SERVO_INFO argv[0]
+// FR_SERVO_PARA is the drogue on OC1A
+#define SRV_MAIN        0xc2    // main chute on OC1B
+#define SRV_BOTH        0xcb    // both servos, argv[1] para sense, argv[2] main sense
+
+#define SRV_PARA_CHAN   0
+#define SRV_MAIN_CHAN   1
+#define SRV_NB          2
 
 #define SERVO_DDR       DDRB
 #define SERVO_PORT      PORTB
 #define SERVO_PIN       PINB
 #define SERVO_PARA      _BV(PB1)
+#define SERVO_MAIN      _BV(PB2)
+
+// potentiometer taps on the adc inputs
+#define SERVO_FB_PARA   0       // ADC0 (PC0)
+#define SERVO_FB_MAIN   1       // ADC1 (PC1)
+
+// the pwm is generated by the timer1 compares on the free running counter
+// the output is set or cleared by the hardware on the match
+// and the interrupt only programs the next edge
+//
+// both channels start their period at the same count
+// and the first interrupt served at that count latches the required widths
+// before either channel computes its next pulse
+// so a move of both servos starts in the same period
+#define SERVO_PERIOD    (20 * TMB_TMR1_1_MSEC)
+
+
+// ------------------------------------------
+// private types
+//
+
+typedef struct {
+        struct {
+                s8 open_pos;                // open position
+                s8 close_pos;                // closed position
+                u8 speed;                // ramp max speed
+                u8 acc;                        // ramp acceleration
+                u8 hold;                // hold time
+                u8 refresh;                // refresh period
+                u8 feedback;                // wait for the position feedback
+        } para;
+
+        struct {
+                u16 periods;                // periods since the end of the move
+                u16 refresh;                // periods since the last refresh pulse
+        } hold;
+
+        struct {
+                u16 vel;                // current speed [count / period]
+                u8 moving;                // a move is latched and not yet reached
+                u8 sense;                // sense of the current move
+        } ramp;
+
+        // required pulse width [timer1 count], 0 if off
+        // it is latched at the next period start
+        volatile u16 req;
+        volatile u8 update;
+
+        u8 id;                        // servo identifier
+        u8 fb_chan;                // adc channel of the potentiometer tap
+        u32 cmd_time;                // time of the last move command
+        u8 chan;                // timer1 compare channel
+        u8 com_mask;                // output compare mode bits of the channel
+        u8 com_set;
+        u8 com_clear;
+
+        u16 rise;                // timer1 count of the current period start
+        u16 width;                // pulse width target of the current move
+        u16 pulse;                // pulse width of the current period
+        u8 rising;                // the next match starts a pulse
+} srv_chan_t;
 
 
 // ------------------------------------------
@@ -33,22 +144,40 @@ struct {
 
         dpt_interface_t interf;        // interface to the dispatcher
 
-        struct {
-                s8 open_pos;                // open position
-                s8 close_pos;                // closed position
-        } para;
+        srv_chan_t ch[SRV_NB];        // servo channels
+        u16 latch;                // period start of the last widths latch
+
+        // move completion events posted by the timer1 interrupt
+        pt_t pt_done;
+        ring_t ev;
+        u8 ev_buf[EV_RING_SIZE];
+
+        // position feedback of the completed move
+        srv_chan_t* done;        // channel of the completed move, NULL if none
+        u32 fb_cmd_time;        // its command time and sense, a new command may change the channel ones
+        u8 fb_sense;
+        tmb_alarm_t fb_alarm;        // sampling alarm
+        ring_t fb_ev;                // sampling events posted by the timer2 interrupt
+        u8 fb_ev_buf[FB_RING_SIZE];
+        u32 fb_sample;                // next sampling time
+        u32 fb_settle;                // time of the first stable sample
+        u8 fb_pos;                // last sampled position
+        u8 fb_nb;                // number of stable samples
+        u8 fb_status;                // SRV_DONE or SRV_STALL
 
         // incoming frames fifo
         fifo_t in;
         frame_t in_buf[IN_FIFO_SIZE];
 
-        // outgoing frames fifo
+        // outgoing frames handles fifo
         fifo_t out;
-        frame_t out_buf[OUT_FIFO_SIZE];
+        pol_t out_buf[OUT_FIFO_SIZE];
 
-        frame_t out_fr;        // frame for the sending thread
-        frame_t in_fr;        // frame for the cmde thread
+        pol_t out_hd;        // pool frame for the sending thread
+        u8 burst;                // frames sent under the current dispatcher lock
+        frame_t in_fr;        // command being handled, not from the pool so the fifo always drains
 
+        u8 sending;                // a frame is waiting for the dispatcher
 } srv;
 
 
@@ -56,62 +185,234 @@ struct {
 // private functions
 //
 
-// activate the para servo to drive it to the given position
-static void srv_para_on(s8 position)
+// compute the pulse width of the next period
+// the width follows a trapezoidal speed profile toward the required one
+static u16 srv_ramp(srv_chan_t* ch)
+{
+        u16 target = ch->width;
+        u16 dist;
+
+        // an unpowered servo position is unknown, so no ramp from or to the off state
+        if (target == 0 || ch->pulse == 0 || ch->para.speed == 0) {
+                ch->ramp.vel = 0;
+                return target;
+        }
+
+        if (ch->pulse == target) {
+                ch->ramp.vel = 0;
+                return target;
+        }
+
+        dist = ch->pulse < target ? target - ch->pulse : ch->pulse - target;
+
+        if (ch->para.acc == 0) {
+                ch->ramp.vel = ch->para.speed;
+        } else if ((u32)ch->ramp.vel * ch->ramp.vel >= 2 * (u32)ch->para.acc * dist) {
+                // brake, the remaining distance is the stopping one
+                if (ch->ramp.vel > 2 * ch->para.acc)
+                        ch->ramp.vel -= ch->para.acc;
+                else
+                        ch->ramp.vel = ch->para.acc;
+        } else {
+                // accelerate up to the max speed
+                ch->ramp.vel += ch->para.acc;
+                if (ch->ramp.vel > ch->para.speed)
+                        ch->ramp.vel = ch->para.speed;
+        }
+
+        if (ch->ramp.vel > dist)
+                ch->ramp.vel = dist;
+
+        return ch->pulse < target ? ch->pulse + ch->ramp.vel : ch->pulse - ch->ramp.vel;
+}
+
+// check if the servo is powered during the next period
+// it is powered during the move and the hold time
+// then only by periodic refresh pulses
+static u8 srv_powered(srv_chan_t* ch)
+{
+        if (ch->ramp.moving || ch->pulse != ch->width) {
+                ch->hold.periods = 0;
+                return 1;
+        }
+
+        if (ch->para.hold == 0)
+                return 1;
+
+        if (ch->hold.periods < ch->para.hold * SRV_PERIODS) {
+                ch->hold.periods++;
+                ch->hold.refresh = 0;
+                return 1;
+        }
+
+        if (ch->para.refresh && ++ch->hold.refresh >= ch->para.refresh * SRV_PERIODS) {
+                ch->hold.refresh = 0;
+                return 1;
+        }
+
+        return 0;
+}
+
+// latch the required widths of every channel once per period
+static void srv_latch(u16 rise)
+{
+        u8 i;
+
+        if (rise == srv.latch)
+                return;
+        srv.latch = rise;
+
+        for (i = 0; i < SRV_NB; i++) {
+                if (srv.ch[i].update) {
+                        srv.ch[i].update = 0;
+                        srv.ch[i].width = srv.ch[i].req;
+                        srv.ch[i].ramp.moving = 1;
+                }
+        }
+}
+
+// timer1 compare interrupt, program the next pwm edge of the channel
+static void srv_pwm(void* misc)
 {
-        // compute the compare value according to the required position and the prescaler
-        // for position = -90 degrees, signal up time shall be 1 ms so compare = 2000
-        // for position = 0 degrees, signal up time shall be 1.5 ms so compare = 3000
-        // for position = +90 degrees, signal up time shall be 2 ms so compare = 4000
-        // compare = (position / 90) * 1000 + 3000
+        srv_chan_t* ch = misc;
+
+        // the first interrupt of the period latches for both channels
+        // a pulse end is in an already latched period
+        srv_latch(ch->rise);
+
+        if (ch->rising) {
+                // the pulse has just started, its end is cleared by the hardware
+                ch->rising = 0;
+                TMR1_compare_set(ch->chan, ch->rise + ch->pulse);
+                TCCR1A = (TCCR1A & ~ch->com_mask) | ch->com_clear;
+                return;
+        }
+
+        // next period, the output stays low if the servo is off or unpowered
+        // an unpowered servo keeps its pulse width for its next move
+        ch->rise += SERVO_PERIOD;
+        ch->pulse = srv_ramp(ch);
+        ch->rising = ch->pulse && srv_powered(ch) ? 1 : 0;
+
+        // signal the end of the move
+        if (ch->ramp.moving && ch->pulse == ch->width) {
+                ch->ramp.moving = 0;
+                if (KO == RING_put(&srv.ev, ch - srv.ch))
+                        prf_drop(PRF_Q_SRV_EV);
+        }
+
+        TMR1_compare_set(ch->chan, ch->rise);
+        TCCR1A = (TCCR1A & ~ch->com_mask) | (ch->rising ? ch->com_set : ch->com_clear);
+}
+
+// require the servo pulse width, 0 to switch it off
+static void srv_width(srv_chan_t* ch, u16 width)
+{
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                ch->req = width;
+                ch->update = 1;
+        }
+}
+
+// activate the servo to drive it to the given position
+static void srv_on(srv_chan_t* ch, s8 position)
+{
+        // compute the pulse width according to the required position and the prescaler
+        // for position = -90 degrees, signal up time shall be 1 ms so width = 2000
+        // for position = 0 degrees, signal up time shall be 1.5 ms so width = 3000
+        // for position = +90 degrees, signal up time shall be 2 ms so width = 4000
+        // width = (position / 90) * 1000 + 3000
         // the computation shall be modified to fit in s16
         // the result is sure to fit in u16
-        TMR1_compare_set(TMR1_A, ((s16)position * 100 / 9) + 3000);
+        // the pulse moves toward the new width from the next period start
+        srv_width(ch, ((s16)position * 100 / 9) + 3000);
 }
 
-// deactivate the para servo to save power
-static void srv_para_off(void)
+// deactivate the servo to save power
+static void srv_off(srv_chan_t* ch)
 {
-        // setting the compare value to 0, ensure output pin is driven lo
-        TMR1_compare_set(TMR1_A, 0);
+        // a null width keeps the output pin driven lo
+        srv_width(ch, 0);
+}
+
+static void srv_move(srv_chan_t* ch, u8 sense)
+{
+        switch (sense) {
+        case FR_SERVO_OPEN:        // open
+                srv_on(ch, ch->para.open_pos);
+                break;
+
+        case FR_SERVO_CLOSE:        // close
+                srv_on(ch, ch->para.close_pos);
+                break;
+
+        case FR_SERVO_OFF:
+                srv_off(ch);
+                break;
+
+        default:
+                return;
+        }
+
+        ch->ramp.sense = sense;
+        ch->cmd_time = tmb_now_us();
 }
 
-static void srv_drive(u8 servo, u8 sense)
+static u8 srv_drive(u8 servo, u8 sense, u8 sense_main)
 {
         switch (servo) {
         case FR_SERVO_PARA:
-                switch (sense) {
-                case FR_SERVO_OPEN:        // open
-                        srv_para_on(srv.para.open_pos);
-                        break;
-
-                case FR_SERVO_CLOSE:        // close
-                        srv_para_on(srv.para.close_pos);
-                        break;
+                srv_move(&srv.ch[SRV_PARA_CHAN], sense);
+                break;
 
-                case FR_SERVO_OFF:
-                        srv_para_off();
-                        break;
+        case SRV_MAIN:
+                srv_move(&srv.ch[SRV_MAIN_CHAN], sense);
+                break;
 
-                default:
-                        break;
+        case SRV_BOTH:
+                // both widths are latched in the same period
+                ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                        srv_move(&srv.ch[SRV_PARA_CHAN], sense);
+                        srv_move(&srv.ch[SRV_MAIN_CHAN], sense_main);
                 }
                 break;
 
         default:
-                break;
+                return KO;
         }
+
+        return OK;
 }
 
-static void srv_para_save(frame_t* fr)
+static void srv_para_save(srv_chan_t* ch, frame_t* fr)
 {
         switch ( fr->argv[2] ) {
         case FR_SERVO_OPEN:        // open position
-                srv.para.open_pos = fr->argv[3];
+                ch->para.open_pos = fr->argv[3];
                 break;
 
         case FR_SERVO_CLOSE:        // closed position
-                srv.para.close_pos = fr->argv[3];
+                ch->para.close_pos = fr->argv[3];
+                break;
+
+        case SRV_RAMP_SPEED:
+                ch->para.speed = fr->argv[3];
+                break;
+
+        case SRV_RAMP_ACC:
+                ch->para.acc = fr->argv[3];
+                break;
+
+        case SRV_HOLD:
+                ch->para.hold = fr->argv[3];
+                break;
+
+        case SRV_REFRESH:
+                ch->para.refresh = fr->argv[3];
+                break;
+
+        case SRV_FEEDBACK:
+                ch->para.feedback = fr->argv[3];
                 break;
 
         default:
@@ -121,15 +422,35 @@ static void srv_para_save(frame_t* fr)
         }
 }
 
-static void srv_para_read(frame_t* fr)
+static void srv_para_read(srv_chan_t* ch, frame_t* fr)
 {
         switch ( fr->argv[2] ) {
         case FR_SERVO_OPEN:        // open position
-                fr->argv[3] = srv.para.open_pos;
+                fr->argv[3] = ch->para.open_pos;
                 break;
 
         case FR_SERVO_CLOSE:        // closed position
-                fr->argv[3] = srv.para.close_pos;
+                fr->argv[3] = ch->para.close_pos;
+                break;
+
+        case SRV_RAMP_SPEED:
+                fr->argv[3] = ch->para.speed;
+                break;
+
+        case SRV_RAMP_ACC:
+                fr->argv[3] = ch->para.acc;
+                break;
+
+        case SRV_HOLD:
+                fr->argv[3] = ch->para.hold;
+                break;
+
+        case SRV_REFRESH:
+                fr->argv[3] = ch->para.refresh;
+                break;
+
+        case SRV_FEEDBACK:
+                fr->argv[3] = ch->para.feedback;
                 break;
 
         default:
@@ -140,22 +461,30 @@ static void srv_para_read(frame_t* fr)
 
 static void srv_position(frame_t* fr)
 {
+        srv_chan_t* ch;
+
         switch ( fr->argv[0] ) {
         case FR_SERVO_PARA:
-                switch ( fr->argv[1] ) {
-                case FR_SERVO_SAVE:        // save
-                        srv_para_save(fr);
-                        break;
+                ch = &srv.ch[SRV_PARA_CHAN];
+                break;
 
-                case FR_SERVO_READ:        // read
-                        srv_para_read(fr);
-                        break;
+        case SRV_MAIN:
+                ch = &srv.ch[SRV_MAIN_CHAN];
+                break;
 
-                default:
-                        // shall never happen
-                        fr->error = 1;
-                        break;
-                }
+        default:
+                // shall never happen
+                fr->error = 1;
+                return;
+        }
+
+        switch ( fr->argv[1] ) {
+        case FR_SERVO_SAVE:        // save
+                srv_para_save(ch, fr);
+                break;
+
+        case FR_SERVO_READ:        // read
+                srv_para_read(ch, fr);
                 break;
 
         default:
@@ -172,12 +501,11 @@ static PT_THREAD( srv_in(pt_t* pt) )
         PT_BEGIN(pt);
 
         // if no incoming frame is available
-        PT_WAIT_UNTIL(pt, OK == FIFO_get(&srv.in, &srv.in_fr) );
+        PT_WAIT_UNTIL(pt, OK == FIFO_get(&srv.in, &srv.in_fr));
 
         // if it is a response
         if (srv.in_fr.resp) {
                 // ignore it
-
                 // release the dispatcher
 //                dpt_unlock(&srv.interf);
 
@@ -189,8 +517,11 @@ static PT_THREAD( srv_in(pt_t* pt) )
 
         switch (srv.in_fr.cmde) {
                 case FR_MINUT_SERVO_CMD:
-                        // drive the servo
-                        srv_drive(srv.in_fr.argv[0], srv.in_fr.argv[1]);
+                        // drive the servo, the completion is signaled by an other response
+                        if (KO == srv_drive(srv.in_fr.argv[0], srv.in_fr.argv[1], srv.in_fr.argv[2]))
+                                srv.in_fr.error = 1;
+                        srv.in_fr.argv[3] = SRV_ACK;
+                        rec_log(REC_SERVO_CMD, tmb_now_us(), srv.in_fr.argv[0], srv.in_fr.argv[1], srv.in_fr.error);
                         break;
 
                 case FR_MINUT_SERVO_INFO:
@@ -203,13 +534,20 @@ static PT_THREAD( srv_in(pt_t* pt) )
                         break;
         }
 
-        // send the response
+        // send the response built in place
         swap = srv.in_fr.orig;
         srv.in_fr.orig = srv.in_fr.dest;
         srv.in_fr.dest = swap;
         srv.in_fr.resp = 1;
         //srv.in_fr.nat = 0;
-        PT_WAIT_UNTIL(pt, OK == FIFO_put(&srv.out, &srv.in_fr));
+
+        // the interface is shared with the completions thread
+        PT_WAIT_UNTIL(pt, !srv.sending);
+        srv.sending = 1;
+        dpt_lock(&srv.interf);
+        PT_WAIT_UNTIL(pt, OK == prf_try(PRF_Q_SRV_DPT, rte_tx(&srv.interf, &srv.in_fr)));
+        dpt_unlock(&srv.interf);
+        srv.sending = 0;
 
         // and restart waiting for incoming command
         PT_RESTART(pt);
@@ -217,22 +555,108 @@ static PT_THREAD( srv_in(pt_t* pt) )
         PT_END(pt);
 }
 
+// start a conversion of the given potentiometer tap
+static void srv_adc_start(u8 chan)
+{
+        // 8 bits left adjusted result
+        ADMUX = _BV(REFS0) | _BV(ADLAR) | chan;
+        ADCSRA |= _BV(ADSC);
+}
+
+static PT_THREAD( srv_done(pt_t* pt) )
+{
+        u8 pos;
+        u8 i;
+        u16 settle;
+        pol_t hd;
+
+        PT_BEGIN(pt);
+
+        // wait for the end of a pwm move
+        PT_WAIT_UNTIL(pt, OK == RING_get(&srv.ev, &i));
+        srv.done = &srv.ch[i];
+        srv.fb_cmd_time = srv.done->cmd_time;
+        srv.fb_sense = srv.done->ramp.sense;
+        srv.fb_settle = tmb_now_us();
+        srv.fb_status = SRV_DONE;
+        srv.fb_pos = 0;
+
+        // wait for the potentiometer tap to settle
+        if (srv.done->para.feedback) {
+                ADCSRA |= _BV(ADEN);
+                srv.fb_nb = 0;
+                srv.fb_sample = srv.fb_settle;
+
+                do {
+                        srv.fb_sample += SRV_FB_PERIOD;
+                        tmb_alarm_set(&srv.fb_alarm, srv.fb_sample);
+                        PT_WAIT_UNTIL(pt, OK == RING_get(&srv.fb_ev, &i));
+
+                        // the conversion takes about 100 us
+                        srv_adc_start(srv.done->fb_chan);
+                        PT_WAIT_WHILE(pt, ADCSRA & _BV(ADSC));
+                        pos = ADCH;
+
+                        if (srv.fb_nb && pos <= srv.fb_pos + SRV_FB_TOL && pos + SRV_FB_TOL >= srv.fb_pos) {
+                                srv.fb_nb++;
+                        } else {
+                                srv.fb_nb = 1;
+                                srv.fb_pos = pos;
+                                srv.fb_settle = tmb_now_us();
+                        }
+
+                        if (srv.fb_nb < SRV_FB_STABLE && tmb_elapsed(srv.fb_cmd_time + SRV_FB_TIME_OUT)) {
+                                srv.fb_status = SRV_STALL;
+                                break;
+                        }
+                } while (srv.fb_nb < SRV_FB_STABLE);
+
+                ADCSRA &= ~_BV(ADEN);
+        }
+
+        // and for a free frame
+        PT_WAIT_UNTIL(pt, FIFO_free(&srv.out) && OK == pol_alloc(&hd, POL_HIGH));
+
+        // the completion is a command response so the servo does not handle it again
+        settle = (srv.fb_settle - srv.fb_cmd_time) / TMB_1_MSEC;
+        if (srv.fb_status == SRV_STALL)
+                settle = 0xffff;
+        frame_set_6(pol_frame(hd), DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_SERVO_CMD, 0,
+                        srv.done->id, srv.fb_sense, srv.fb_pos, srv.fb_status, settle >> 8, settle >> 0);
+        pol_frame(hd)->resp = 1;
+        FIFO_put(&srv.out, &hd);
+        rec_log(REC_SERVO_DONE, srv.fb_settle, srv.done->id, srv.fb_status, srv.fb_pos);
+        srv.done = NULL;
+
+        PT_RESTART(pt);
+
+        PT_END(pt);
+}
+
 static PT_THREAD( srv_out(pt_t* pt) )
 {
         PT_BEGIN(pt);
 
-        // wait until a frame to send is available
-        PT_WAIT_UNTIL(pt, OK == FIFO_get(&srv.out, &srv.out_fr));
+        // wait until a frame to send is available and the interface is free
+        PT_WAIT_UNTIL(pt, !srv.sending && OK == FIFO_get(&srv.out, &srv.out_hd));
+        srv.sending = 1;
 
         // send it throught the dispatcher
         dpt_lock(&srv.interf);
+        srv.burst = 0;
+
+        // the completions queued meanwhile are sent under the same lock
+        do {
+                // some retry may be necessary
+                PT_WAIT_UNTIL(pt, OK == prf_try(PRF_Q_SRV_DPT, rte_tx(&srv.interf, pol_frame(srv.out_hd))));
 
-        // some retry may be necessary
-        PT_WAIT_UNTIL(pt, OK == dpt_tx(&srv.interf, &srv.out_fr));
+                // the frame is copied by the dispatcher
+                pol_free(srv.out_hd);
+        } while (++srv.burst < OUT_FIFO_SIZE && OK == FIFO_get(&srv.out, &srv.out_hd));
 
-        // release the dispatcher if a reply
- //       if (srv.out_fr.resp)
-                dpt_unlock(&srv.interf);
+        // release the dispatcher
+        dpt_unlock(&srv.interf);
+        srv.sending = 0;
 
         // loop back at start
         PT_RESTART(pt);
@@ -247,35 +671,108 @@ static PT_THREAD( srv_out(pt_t* pt) )
 
 void srv_init(void)
 {
+        srv_chan_t* ch;
+        u16 rise;
+        u8 i;
+
         // init
         FIFO_init(&srv.in, &srv.in_buf, IN_FIFO_SIZE, sizeof(frame_t));
-        FIFO_init(&srv.out, &srv.out_buf, OUT_FIFO_SIZE, sizeof(frame_t));
+        FIFO_init(&srv.out, &srv.out_buf, OUT_FIFO_SIZE, sizeof(pol_t));
 
         srv.interf.channel = 10;
         srv.interf.cmde_mask = _CM(FR_MINUT_SERVO_CMD) | _CM(FR_MINUT_SERVO_INFO);
         srv.interf.queue = &srv.in;
-        dpt_register(&srv.interf);
+        rte_register(&srv.interf);
 
         PT_INIT(&srv.pt_in);
         PT_INIT(&srv.pt_out);
+        PT_INIT(&srv.pt_done);
 
-        // configure port
-        SERVO_DDR |= SERVO_PARA;
+        RING_init(&srv.ev, srv.ev_buf, EV_RING_SIZE);
+        RING_init(&srv.fb_ev, srv.fb_ev_buf, FB_RING_SIZE);
+        tmb_alarm_init(&srv.fb_alarm, &srv.fb_ev, SRV_EV_FB);
+        srv.fb_pos = 0;
+        srv.done = NULL;
+
+        // the adc is only enabled during the feedback sampling
+        ADCSRA = _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+        DIDR0 |= _BV(SERVO_FB_PARA) | _BV(SERVO_FB_MAIN);
 
-        // init the driver, by default, the pwm is zero
-        TMR1_init(TMR1_WITHOUT_INTERRUPT, TMR1_PRESCALER_8, TMR1_WGM_FAST_PWM_ICR1, COM1AB_1010, NULL, NULL);
+        srv.sending = 0;
 
-        TMR1_compare_set(TMR1_CAPT, 40000);
+        // configure port
+        SERVO_DDR |= SERVO_PARA | SERVO_MAIN;
+
+        srv.ch[SRV_PARA_CHAN].id = FR_SERVO_PARA;
+        srv.ch[SRV_PARA_CHAN].fb_chan = SERVO_FB_PARA;
+        srv.ch[SRV_PARA_CHAN].chan = TMR1_A;
+        srv.ch[SRV_PARA_CHAN].com_mask = _BV(COM1A1) | _BV(COM1A0);
+        srv.ch[SRV_PARA_CHAN].com_set = _BV(COM1A1) | _BV(COM1A0);
+        srv.ch[SRV_PARA_CHAN].com_clear = _BV(COM1A1);
+
+        srv.ch[SRV_MAIN_CHAN].id = SRV_MAIN;
+        srv.ch[SRV_MAIN_CHAN].fb_chan = SERVO_FB_MAIN;
+        srv.ch[SRV_MAIN_CHAN].chan = TMR1_B;
+        srv.ch[SRV_MAIN_CHAN].com_mask = _BV(COM1B1) | _BV(COM1B0);
+        srv.ch[SRV_MAIN_CHAN].com_set = _BV(COM1B1) | _BV(COM1B0);
+        srv.ch[SRV_MAIN_CHAN].com_clear = _BV(COM1B1);
+
+        tmb_tmr1_register(TMR1_A, srv_pwm, &srv.ch[SRV_PARA_CHAN]);
+        tmb_tmr1_register(TMR1_B, srv_pwm, &srv.ch[SRV_MAIN_CHAN]);
+
+        // launch the pwm generation on the free running timer1
+        // by default, the pwm is zero
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                rise = TCNT1 + SERVO_PERIOD;
+                srv.latch = rise - SERVO_PERIOD;
+
+                for (i = 0; i < SRV_NB; i++) {
+                        ch = &srv.ch[i];
+
+                        ch->para.speed = SRV_SPEED;
+                        ch->para.acc = SRV_ACC;
+                        ch->para.hold = SRV_HOLD_TIME;
+                        ch->para.refresh = SRV_REFRESH_TIME;
+                        ch->para.feedback = 0;
+                        ch->cmd_time = 0;
+                        ch->hold.periods = 0;
+                        ch->hold.refresh = 0;
+                        ch->ramp.vel = 0;
+                        ch->ramp.moving = 0;
+
+                        ch->req = 0;
+                        ch->update = 0;
+                        ch->width = 0;
+                        ch->pulse = 0;
+                        ch->rising = 0;
+
+                        ch->rise = rise;
+                        TMR1_compare_set(ch->chan, rise);
+                        TCCR1A = (TCCR1A & ~ch->com_mask) | ch->com_clear;
+                }
 
-        // launch the pwm generation
-        TMR1_start();
+                TIFR1 = _BV(OCF1A) | _BV(OCF1B);
+                TIMSK1 |= _BV(OCIE1A) | _BV(OCIE1B);
+        }
 }
 
-void srv_run(void)
+u8 srv_run(void)
 {
+        prf_queue(PRF_Q_SRV_IN, FIFO_full(&srv.in));
+        prf_queue(PRF_Q_SRV_EV, RING_count(&srv.ev));
+
         // if incoming command available
         (void)PT_SCHEDULE(srv_in(&srv.pt_in));
 
+        // if a move is completed
+        (void)PT_SCHEDULE(srv_done(&srv.pt_done));
+
         // if outgoing frame to send
+        prf_queue(PRF_Q_SRV_OUT, FIFO_full(&srv.out));
         (void)PT_SCHEDULE(srv_out(&srv.pt_out));
+
+        // the pwm and the ramp run in interrupt, only pending frames or events need the cpu
+        // the feedback sampling is paced by its alarm, but the adc conversion does not interrupt
+        return ( FIFO_full(&srv.in) || FIFO_full(&srv.out) || (!srv.done && RING_count(&srv.ev)) || srv.sending
+                        || RING_count(&srv.fb_ev) || (ADCSRA & _BV(ADSC)) );
 }
@@ -1,10 +1,13 @@
 #ifndef __SERVO_H__
 # define __SERVO_H__
 
+#include "type_def.h"
+
 
 // servo handling
 extern void srv_init(void);
 
-extern void srv_run(void);
+// return non-zero while some work is pending
+extern u8 srv_run(void);
 
 #endif	// __SERVO_H__
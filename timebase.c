@@ -0,0 +1,445 @@
+#include "timebase.h"
+#include "prof.h"
+
+#include "drivers/timer1.h"
+#include "drivers/timer2.h"
+#include "utils/time.h"
+
+#include "avr/io.h"
+#include "util/atomic.h"
+
+#include <stdbool.h>
+
+// timer2 is free running and its compare is programmed
+// for the earliest requested deadline
+// the elapsed counts are added to the on-board time at each compare
+//
+// the micro-second clock is counted by timer1 which runs faster:
+// its counts elapsed since the last compare are accounted at each one
+// so the timer2 step stays long and an idle cpu seldom wakes up
+//
+// the armed timers are kept in a list sorted by expiry time
+// so only the head is compared to the current time
+//
+// every time is in micro-second and wraps after 71 minutes
+// so they are only compared through their signed difference
+//
+// timer1 runs free and its channels are shared by the modules
+// for timestamping (input capture) and signal generation (compares)
+
+// ------------------------------------------
+// private definitions
+//
+
+// @ 16 MHz with a 1024 prescaler, a count lasts 64 us
+#define TMB_PRESCALER   1024
+
+// count duration [us] and its inverse [count/us] in fixed point
+#define TMB_US_Q8       ((u32)((TMB_PRESCALER * 1000000ULL << 8) / F_CPU))
+#define TMB_CNT_Q16     ((u32)(((u64)F_CPU << 16) / (TMB_PRESCALER * 1000000ULL)))
+
+// a count is 16/25 of an on-board time unit (100 us)
+#define TMB_CNT_NUM     16
+#define TMB_CNT_DEN     25
+
+// longest compare step (15.36 ms), margin for the interrupt latency [count]
+// so timer1 (32.768 ms) does not wrap between two compares either
+#define TMB_STEP_MAX    240
+#define TMB_STEP_MIN    2       // shortest step not to miss the compare [count]
+
+#define TMB_TMR1_NB     3       // capture, compare A and compare B
+
+// timer1 counts per timer2 count, both prescalers are started together
+// so a timer2 count starts when the timer1 low bits are null
+#define TMB_TMR1_PER_CNT        (TMB_PRESCALER / 8)
+
+
+// ------------------------------------------
+// private variables
+//
+
+struct {
+        u8 last;                // compare value of the last interrupt
+        u8 frac;                // on-board time not yet accounted [1/25 unit]
+        u32 us;                 // micro-second clock at the last interrupt
+        u16 us_cnt;             // timer1 count of this micro-second
+        u32 wake;               // earliest requested wake-up time
+        u32 deadline;           // earliest of the wake-up and timers times
+        u8 wake_armed;          // a wake-up is requested
+        u8 pending;             // the deadline is valid
+        volatile u8 activity;   // an interrupt may have given work to the main loop
+
+        tmb_timer_t* head;      // armed timers list
+
+        struct {
+                void (*call_back)(void* misc);
+                void* misc;
+        } tmr1[TMB_TMR1_NB];    // timer1 channels users
+} tmb;
+
+
+// ------------------------------------------
+// private functions
+//
+
+static u32 tmb_adjust(void)
+{
+        u8 elapsed = TCNT2 - tmb.last;
+
+        return (tmb.frac + elapsed * TMB_CNT_NUM) / TMB_CNT_DEN;
+}
+
+// current micro-second time, interrupts shall be disabled
+static u32 tmb_now(void)
+{
+        return tmb.us + ((u16)(TCNT1 - tmb.us_cnt) >> 1);
+}
+
+// account the micro-seconds elapsed on timer1, interrupts shall be disabled
+static void tmb_account(void)
+{
+        u16 elapsed = TCNT1 - tmb.us_cnt;
+
+        // an odd count is kept for the next time
+        tmb.us += elapsed >> 1;
+        tmb.us_cnt += elapsed & ~1;
+}
+
+// program the next compare, interrupts shall be disabled
+static void tmb_program(void)
+{
+        u8 elapsed = TCNT2 - tmb.last;
+        s32 delay = tmb.deadline - tmb_now();
+        u16 step;
+
+        // a matched compare not yet serviced accounts up to OCR2A,
+        // its interrupt programs the next one
+        if (TIFR2 & _BV(OCF2A))
+                return;
+
+        // the pending compare is too close to be moved
+        if (elapsed > TMB_STEP_MAX - TMB_STEP_MIN)
+                return;
+
+        if (!tmb.pending) {
+                step = TMB_STEP_MAX;
+        } else if (delay <= 0) {
+                step = 0;
+        } else if ((u32)delay >= (TMB_STEP_MAX * TMB_US_Q8) >> 8) {
+                step = TMB_STEP_MAX;
+        } else {
+                // round up to not wake before the deadline
+                step = elapsed + (((u32)delay * TMB_CNT_Q16 + 0xffff) >> 16);
+        }
+
+        if (step < elapsed + TMB_STEP_MIN)
+                step = elapsed + TMB_STEP_MIN;
+        if (step > TMB_STEP_MAX)
+                step = TMB_STEP_MAX;
+
+        OCR2A = tmb.last + step;
+}
+
+// compute the deadline from the wake-up and the timers list head, interrupts shall be disabled
+static void tmb_next(void)
+{
+        tmb.pending = tmb.wake_armed;
+        tmb.deadline = tmb.wake;
+
+        if (tmb.head != NULL && (!tmb.pending || (s32)(tmb.head->time - tmb.deadline) < 0)) {
+                tmb.pending = true;
+                tmb.deadline = tmb.head->time;
+        }
+}
+
+// advance the deadline if the given time is earlier, interrupts shall be disabled
+static void tmb_earlier(u32 time)
+{
+        if (!tmb.pending || (s32)(time - tmb.deadline) < 0) {
+                tmb.pending = true;
+                tmb.deadline = time;
+                tmb_program();
+        }
+}
+
+// remove the timer from the armed list, interrupts shall be disabled
+static void tmb_unlink(tmb_timer_t* tmr)
+{
+        tmb_timer_t** prev;
+
+        for (prev = &tmb.head; *prev != NULL; prev = &(*prev)->next) {
+                if (*prev == tmr) {
+                        *prev = tmr->next;
+                        break;
+                }
+        }
+
+        tmr->armed = false;
+}
+
+static void tmb_alarm_post(void* misc)
+{
+        tmb_alarm_t* al = misc;
+
+        // the event is lost if the previous ones are not handled
+        if (KO == RING_put(al->ring, al->ev))
+                prf_drop(PRF_Q_TMB);
+}
+
+#ifdef ISR_STATS
+// timer1 counts elapsed since the timer2 compare match
+static u16 tmb_latency(void)
+{
+        u16 t1;
+        u8 t2;
+
+        // read again if a timer2 count started between both reads
+        do {
+                t1 = TCNT1;
+                t2 = TCNT2;
+        } while ((TCNT1 ^ t1) & ~(TMB_TMR1_PER_CNT - 1));
+
+        return (u8)(t2 - OCR2A) * TMB_TMR1_PER_CNT + (t1 & (TMB_TMR1_PER_CNT - 1));
+}
+#endif
+
+static void tmb_tmr1(u8 chan, void* misc)
+{
+        prf_mark_t mark;
+
+        (void)misc;
+
+        // the counts elapsed since the capture or the compare match
+        switch (chan) {
+        case TMR1_CAPT:
+                prf_latency(PRF_LAT_TMR1_CAPT, TCNT1 - ICR1);
+                break;
+
+        case TMR1_A:
+                prf_latency(PRF_LAT_TMR1_A, TCNT1 - OCR1A);
+                break;
+
+        case TMR1_B:
+                prf_latency(PRF_LAT_TMR1_B, TCNT1 - OCR1B);
+                break;
+
+        default:
+                break;
+        }
+
+        prf_enter(&mark, PRF_ISR_TMR1);
+
+        if (chan < TMB_TMR1_NB && tmb.tmr1[chan].call_back != NULL) {
+                tmb.tmr1[chan].call_back(tmb.tmr1[chan].misc);
+                tmb.activity = true;
+        }
+
+        prf_leave(&mark, PRF_ISR_TMR1);
+}
+
+static void tmb_compare(void* misc)
+{
+        tmb_timer_t* tmr;
+        u32 now;
+        u8 delta;
+        u16 acc;
+        prf_mark_t mark;
+
+        (void)misc;
+
+        // the timer1 counts elapsed since the compare match
+        prf_latency(PRF_LAT_TMB, tmb_latency());
+
+        prf_enter(&mark, PRF_ISR_TMB);
+
+        // account the counts elapsed since the last compare
+        delta = OCR2A - tmb.last;
+        tmb.last += delta;
+        tmb_account();
+
+        acc = tmb.frac + delta * TMB_CNT_NUM;
+        tmb.frac = acc % TMB_CNT_DEN;
+
+        // on-board time update
+        TIME_set_incr(acc / TMB_CNT_DEN);
+        TIME_incr();
+
+        now = tmb_now();
+
+        // the wake-up is served, next ones will be requested again
+        if (tmb.wake_armed && (s32)(now - tmb.wake) >= 0) {
+                tmb.wake_armed = false;
+                tmb.activity = true;
+        }
+
+        // call back each expired timer
+        while (tmb.head != NULL && (s32)(now - tmb.head->time) >= 0) {
+                tmr = tmb.head;
+                tmb.head = tmr->next;
+                tmr->armed = false;
+
+                tmr->call_back(tmr->misc);
+                tmb.activity = true;
+        }
+
+        tmb_next();
+        tmb_program();
+
+        prf_leave(&mark, PRF_ISR_TMB);
+}
+
+
+// ------------------------------------------
+// public functions
+//
+
+void tmb_init(void)
+{
+        // init on-board time
+        TIME_init(tmb_adjust);
+
+        tmb.last = 0;
+        tmb.frac = 0;
+        tmb.us = 0;
+        tmb.wake_armed = false;
+        tmb.pending = false;
+        tmb.activity = false;
+        tmb.head = NULL;
+
+        // free running timer2 with an interrupt on compare
+        TMR2_init(TMR2_WITH_COMPARE_INT, TMR2_PRESCALER_1024, TMR2_WGM_NORMAL, TMB_STEP_MAX, tmb_compare, NULL);
+        TMR2_start();
+
+        // free running timer1 @ 0.5 us per count, channels interrupts are enabled by their users
+        TMR1_init(TMR1_WITHOUT_INTERRUPT, TMR1_PRESCALER_8, TMR1_WGM_NORMAL, COM1AB_0000, tmb_tmr1, NULL);
+        TMR1_start();
+
+        // restart both timers and their prescalers together
+        // so the timer2 counts are in phase with the timer1 ones
+        GTCCR = _BV(TSM) | _BV(PSRASY) | _BV(PSRSYNC);
+        TCNT1 = 0;
+        TCNT2 = 0;
+        GTCCR = 0;
+
+        // the micro-second clock starts now, the interrupts are not yet enabled
+        tmb.us_cnt = TCNT1;
+}
+
+u8 tmb_activity(void)
+{
+        u8 activity = tmb.activity;
+
+        tmb.activity = false;
+
+        return activity;
+}
+
+u32 tmb_now_us(void)
+{
+        u32 now;
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                now = tmb_now();
+        }
+
+        return now;
+}
+
+void tmb_deadline(u32 deadline)
+{
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                if (!tmb.wake_armed || (s32)(deadline - tmb.wake) < 0) {
+                        tmb.wake_armed = true;
+                        tmb.wake = deadline;
+                }
+
+                tmb_earlier(deadline);
+        }
+}
+
+u8 tmb_elapsed(u32 deadline)
+{
+        if ((s32)(tmb_now_us() - deadline) >= 0)
+                return true;
+
+        tmb_deadline(deadline);
+
+        return false;
+}
+
+void tmb_timer_init(tmb_timer_t* tmr, void (*call_back)(void* misc), void* misc)
+{
+        tmr->next = NULL;
+        tmr->time = 0;
+        tmr->call_back = call_back;
+        tmr->misc = misc;
+        tmr->armed = false;
+}
+
+void tmb_timer_start(tmb_timer_t* tmr, u32 time)
+{
+        tmb_timer_t** prev;
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                if (tmr->armed)
+                        tmb_unlink(tmr);
+
+                // insert after the timers expiring at the same time or before
+                for (prev = &tmb.head; *prev != NULL && (s32)((*prev)->time - time) <= 0; prev = &(*prev)->next)
+                        ;
+
+                tmr->time = time;
+                tmr->next = *prev;
+                tmr->armed = true;
+                *prev = tmr;
+
+                tmb_earlier(time);
+        }
+}
+
+void tmb_timer_cancel(tmb_timer_t* tmr)
+{
+        // the programmed compare may only give a spurious wake-up
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                if (tmr->armed)
+                        tmb_unlink(tmr);
+        }
+}
+
+void tmb_alarm_init(tmb_alarm_t* al, ring_t* ring, u8 ev)
+{
+        al->ring = ring;
+        al->ev = ev;
+        tmb_timer_init(&al->tmr, tmb_alarm_post, al);
+}
+
+void tmb_alarm_set(tmb_alarm_t* al, u32 time)
+{
+        tmb_timer_start(&al->tmr, time);
+}
+
+void tmb_alarm_cancel(tmb_alarm_t* al)
+{
+        tmb_timer_cancel(&al->tmr);
+}
+
+void tmb_tmr1_register(u8 chan, void (*call_back)(void* misc), void* misc)
+{
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                tmb.tmr1[chan].call_back = call_back;
+                tmb.tmr1[chan].misc = misc;
+        }
+}
+
+u32 tmb_tmr1_to_us(u16 cnt)
+{
+        u32 now;
+        u16 age;
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                now = tmb_now();
+                age = TCNT1 - cnt;
+        }
+
+        return now - (age >> 1);
+}
@@ -0,0 +1,92 @@
+#ifndef __TIMEBASE_H__
+# define __TIMEBASE_H__
+
+#include "type_def.h"
+#include "ring.h"
+
+
+// ------------------------------------------
+// public definitions
+//
+
+// the time base counts in micro-second
+// its times wrap every 71 minutes and shall only be compared
+// through their signed difference : (s32)(t1 - t0) >= 0
+#define TMB_1_USEC      1UL
+#define TMB_1_MSEC      1000UL
+#define TMB_1_SEC       1000000UL
+
+// timer1 runs free at 0.5 us per count
+#define TMB_TMR1_1_MSEC 2000U
+
+
+// ------------------------------------------
+// public types
+//
+
+// a timer calls its call back from the timer2 interrupt at expiry
+typedef struct tmb_timer {
+        struct tmb_timer* next;         // next armed timer, sorted by expiry time
+        u32 time;                       // expiry time [us]
+        void (*call_back)(void* misc);  // shall be short, it runs in interrupt context
+        void* misc;                     // call back argument
+        u8 armed;
+} tmb_timer_t;
+
+// an alarm is a timer posting its event in a ring
+typedef struct {
+        tmb_timer_t tmr;
+        ring_t* ring;           // ring receiving the event
+        u8 ev;                  // event posted at expiry
+} tmb_alarm_t;
+
+
+// ------------------------------------------
+// public functions
+//
+
+// tickless time base on timer2
+extern void tmb_init(void);
+
+// check if a time base interrupt (deadline, timer, alarm, timer1 channel)
+// may have given work to the main loop since the last call
+// interrupts shall be disabled
+extern u8 tmb_activity(void);
+
+// monotonic micro-second clock counted by timer1
+extern u32 tmb_now_us(void);
+
+// request a wake-up at the given time
+extern void tmb_deadline(u32 deadline);
+
+// check if the given time has elapsed
+// else request a wake-up at this time
+extern u8 tmb_elapsed(u32 deadline);
+
+// init a timer, any number of timers can be used
+extern void tmb_timer_init(tmb_timer_t* tmr, void (*call_back)(void* misc), void* misc);
+
+// arm or rearm the timer at the given time, the call back is called once
+// it can be called from a call back to make a periodic timer
+extern void tmb_timer_start(tmb_timer_t* tmr, u32 time);
+
+// disarm the timer
+extern void tmb_timer_cancel(tmb_timer_t* tmr);
+
+// init an alarm posting the given event
+extern void tmb_alarm_init(tmb_alarm_t* al, ring_t* ring, u8 ev);
+
+// arm or rearm the alarm at the given time, the event is posted once
+extern void tmb_alarm_set(tmb_alarm_t* al, u32 time);
+
+// disarm the alarm
+extern void tmb_alarm_cancel(tmb_alarm_t* al);
+
+// set the call back of a timer1 channel (TMR1_CAPT, TMR1_A or TMR1_B)
+// the user enables the channel interrupt in TIMSK1
+extern void tmb_tmr1_register(u8 chan, void (*call_back)(void* misc), void* misc);
+
+// convert a timer1 count latched less than 32 ms ago to the micro-second clock
+extern u32 tmb_tmr1_to_us(u16 cnt);
+
+#endif	// __TIMEBASE_H__
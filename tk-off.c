@@ -1,34 +1,64 @@
 #include "tk-off.h"
+#include "timebase.h"
+#include "acq.h"
+#include "prof.h"
+#include "pool.h"
+#include "route.h"
+#include "ring.h"
 
 #include "dispatcher.h"
 
+#include "drivers/timer1.h"
+
 #include "utils/pt.h"
 #include "utils/fifo.h"
 #include "utils/time.h"
 
 #include "avr/io.h"
+#include "util/atomic.h"
 
 #include <stdbool.h>
 
 // the take-off pin is pull down by a jumper
 // when taking-off, the jumper is removed
 // and the internal pin pull-up drives the pin to 1
+//
+// the pin is the timer1 input capture (ICP1)
+// so the rising edge is latched by the hardware and timestamped in the capture interrupt
+// then a glitch filter checks the pin stays high during the debounce window
+//
+// the pin alone is not trusted, a jumper pulled on the pad would fire the flight
+// so the take-off also needs a sustained acceleration from the accelerometer
+// and a long enough acceleration alone is a take-off with a stuck jumper
+// without any accelerometer sample, the pin is used alone
 
 // ------------------------------------------
 // private definitions
 //
 
 #define IN_FIFO_SIZE        1
+#define EV_RING_SIZE        2
+
+#define TKF_EV_SAMPLE       0x01
 
 #define TKOFF_DDR       DDRB
 #define TKOFF_PORT      PORTB
 #define TKOFF_PIN       PINB
 #define TKOFF_PARA      _BV(PB0)
 
-#define TKF_THRES_HI    5 // high threshold for debounce
-#define TKF_THRES_LO    0 // low threshold for debounce
+#define TKF_WINDOW      10 // [ms] debounce window from the rising edge
+#define TKF_LATENCY     1 // [ms] pin sampling period during the window
+
+#define TKF_ACC_THRES   30      // [0.1 g] acceleration threshold
+#define TKF_ACC_THRES_MAX (ACQ_RANGE * 10)      // [0.1 g] sensor range, the squared threshold fits in u32
+#define TKF_ACC_FUSED   10      // [ms] acceleration duration confirming the pin
+#define TKF_ACC_ALONE   50      // [10 ms] acceleration duration without the pin
+#define TKF_ACQ_STALE   (100 * TMB_1_MSEC)      // no accelerometer after this time
 
-#define TKF_PERIOD      (10 * TIME_1_MSEC) // 100 Hz
+#define TKF_THRES_SAVE  0x00
+#define TKF_THRES_READ  0xff
+#define TKF_ACC_SAVE    0x01
+#define TKF_ACC_READ    0xfe
 
 // ------------------------------------------
 // private variables
@@ -41,13 +71,36 @@ struct {
 
         frame_t in_buf[IN_FIFO_SIZE];   // incoming buffer and fifo for acquisitions or commands
         fifo_t in_fifo;
-        frame_t in_fr;                  // incoming frame
+        frame_t in_fr;                  // command being handled, not from the pool so the fifo always drains
+
+        pol_t out_hd;                   // pool frame for the outgoing frame
 
-        frame_t out_fr;                 // outgoing frame
+        volatile u32 edge_time;         // rising edge time stamp [us]
+        volatile u8 edge;               // rising edge seen and not yet cancelled
 
-        s8 dbnc;                        // debouncing counter
-        u32 period;                     // 100 Hz period net occurrence
+        u32 edge_fr;                    // time stamp of the edge being filtered
+        u32 sample;                     // next pin sampling time
+        tmb_alarm_t alarm;              // pin sampling alarm
+        ring_t ev;                      // sampling events posted by the timer2 interrupt
+        u8 ev_buf[EV_RING_SIZE];
+        u8 window;                      // [ms] debounce window
+        u8 latency;                     // [ms] sampling period in the window
         u8 is_in_waiting_state;       // take off check is only done in waiting state
+
+        // inertial detection
+        u8 acc_thres;                   // [0.1 g] acceleration threshold
+        u8 acc_fused;                   // [ms] acceleration duration confirming the pin
+        u8 acc_alone;                   // [10 ms] acceleration duration without the pin
+        u32 acc_thres2;                 // squared threshold [ACQ_1_G^2]
+        u16 acc_fused_nb;               // durations [samples]
+        u16 acc_alone_nb;
+        u16 acc_nb;                     // consecutive samples above the threshold
+        u32 acc_start;                  // time of the first one
+        u8 acq_seq;                     // sequence number of the last sample
+        u32 acq_time;                   // time of the last sample
+        u32 take_off_time;              // time stamp of the take-off frame
+
+        u8 sending;                     // a frame is waiting for the dispatcher
 } tkf;
 
 
@@ -55,16 +108,207 @@ struct {
 // private functions
 //
 
+// capture the rising edge (ICES1 set) or the falling edge
+static void tkf_capture_sense(u8 rising)
+{
+        if (rising)
+                TCCR1B |= _BV(ICES1);
+        else
+                TCCR1B &= ~_BV(ICES1);
+
+        // changing the sense may trigger a capture
+        TIFR1 = _BV(ICF1);
+}
+
+// rising edge seen at the given time
+static void tkf_rising(u32 time)
+{
+        // only the first rising edge is time stamped
+        if (!tkf.edge) {
+                tkf.edge_time = time;
+                tkf.edge = true;
+
+                // the cpu may have gone to sleep just after the last check
+                // so ensure it is woken up for the first pin sampling
+                tmb_deadline(tkf.edge_time + tkf.latency * TMB_1_MSEC);
+        }
+}
+
+// take-off pin input capture, the captured edge alternates
+static void tkf_capture(void* misc)
+{
+        u16 cnt = TMR1_compare_get(TMR1_CAPT);
+
+        (void)misc;
+
+        if (TCCR1B & _BV(ICES1)) {
+                tkf_rising(tmb_tmr1_to_us(cnt));
+
+                // wait for the falling edge
+                tkf_capture_sense(false);
+
+                // the pin fell before the sense was changed
+                if (!(TKOFF_PIN & TKOFF_PARA))
+                        tkf.edge = false;
+        } else {
+                // falling edge, the previous one was a glitch
+                tkf.edge = false;
+
+                // wait for the rising edge
+                tkf_capture_sense(true);
+
+                // the pin rose before the sense was changed
+                if (TKOFF_PIN & TKOFF_PARA)
+                        tkf_rising(tmb_now_us());
+        }
+}
+
+static void tkf_edge_enable(u8 enable)
+{
+        if (enable) {
+                ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                        tkf.edge = false;
+
+                        // a jumper already removed counts as an edge
+                        if (TKOFF_PIN & TKOFF_PARA) {
+                                tkf_rising(tmb_now_us());
+                                tkf_capture_sense(false);
+                        } else {
+                                tkf_capture_sense(true);
+                        }
+
+                        TIMSK1 |= _BV(ICIE1);
+                }
+        } else {
+                TIMSK1 &= ~_BV(ICIE1);
+        }
+}
+
+// convert the inertial thresholds into samples units
+static void tkf_acc_thres(void)
+{
+        u32 thres = (u32)tkf.acc_thres * ACQ_1_G / 10;
+
+        tkf.acc_thres2 = thres * thres;
+        tkf.acc_fused_nb = (u32)tkf.acc_fused * ACQ_RATE / 1000;
+        tkf.acc_alone_nb = (u32)tkf.acc_alone * ACQ_RATE / 100;
+}
+
+// restart the inertial detection
+static void tkf_acc_reset(void)
+{
+        acq_acc_t acc;
+
+        tkf.acc_nb = 0;
+        tkf.acq_seq = ACQ_get(&acc);
+        tkf.acq_time = tmb_now_us();
+}
+
+// count the consecutive filtered samples above the threshold
+static void tkf_acc_check(void)
+{
+        acq_acc_t acc;
+        u8 seq;
+        u8 nb;
+
+        seq = ACQ_get(&acc);
+        if (seq == tkf.acq_seq)
+                return;
+
+        // only the last of the samples filtered together is read
+        nb = seq - tkf.acq_seq;
+        tkf.acq_seq = seq;
+        tkf.acq_time = tmb_now_us();
+
+        if ((u32)((s32)acc.x * acc.x) + (u32)((s32)acc.y * acc.y) + (u32)((s32)acc.z * acc.z) < tkf.acc_thres2) {
+                tkf.acc_nb = 0;
+                return;
+        }
+
+        if (tkf.acc_nb == 0)
+                tkf.acc_start = tkf.acq_time;
+        if (tkf.acc_nb < 0xffff - nb)
+                tkf.acc_nb += nb;
+}
+
+// check if the debounced pin is confirmed by the acceleration
+static u8 tkf_acc_confirm(void)
+{
+        return tkf.acc_nb >= tkf.acc_fused_nb || tmb_elapsed(tkf.acq_time + TKF_ACQ_STALE);
+}
+
+static void tkf_thres(frame_t* fr)
+{
+        switch (fr->argv[0]) {
+        case TKF_THRES_SAVE:
+                // a null sampling period would never end the window
+                if (fr->argv[2] == 0) {
+                        fr->error = 1;
+                        break;
+                }
+                tkf.window = fr->argv[1];
+                tkf.latency = fr->argv[2];
+                break;
+
+        case TKF_THRES_READ:
+                fr->argv[1] = tkf.window;
+                fr->argv[2] = tkf.latency;
+                break;
+
+        case TKF_ACC_SAVE:
+                // a threshold out of the sensor range would never trigger
+                if (fr->argv[1] > TKF_ACC_THRES_MAX) {
+                        fr->error = 1;
+                        break;
+                }
+                tkf.acc_thres = fr->argv[1];
+                tkf.acc_fused = fr->argv[2];
+                tkf.acc_alone = fr->argv[3];
+                tkf_acc_thres();
+                break;
+
+        case TKF_ACC_READ:
+                fr->argv[1] = tkf.acc_thres;
+                fr->argv[2] = tkf.acc_fused;
+                fr->argv[3] = tkf.acc_alone;
+                break;
+
+        default:
+                // bad sub-command
+                fr->error = 1;
+                break;
+        }
+}
+
 static PT_THREAD( tkf_thread_com(pt_t* pt) )
 {
+        u8 swap;
+
         PT_BEGIN(pt);
 
         // wait incoming commands
         PT_WAIT_UNTIL(pt, OK == FIFO_get(&tkf.in_fifo, &tkf.in_fr));
 
         switch (tkf.in_fr.cmde) {
-        case FR_TAKE_OFF:
-                // take off response is ignored
+        case FR_TAKE_OFF_THRES:
+                // threshold response is ignored
+                if (tkf.in_fr.resp)
+                        break;
+
+                tkf.in_fr.error = 0;
+                tkf_thres(&tkf.in_fr);
+
+                // send the response
+                swap = tkf.in_fr.orig;
+                tkf.in_fr.orig = tkf.in_fr.dest;
+                tkf.in_fr.dest = swap;
+                tkf.in_fr.resp = 1;
+
+                tkf.sending = true;
+                dpt_lock(&tkf.interf);
+                PT_WAIT_UNTIL(pt, OK == prf_try(PRF_Q_TKF_DPT, rte_tx(&tkf.interf, &tkf.in_fr)));
+                dpt_unlock(&tkf.interf);
+                tkf.sending = false;
                 break;
 
         case FR_STATE:
@@ -74,11 +318,13 @@ static PT_THREAD( tkf_thread_com(pt_t* pt) )
 
                 // if state is set to waiting
                 if (tkf.in_fr.argv[0] == FR_STATE_SET && tkf.in_fr.argv[1] == FR_STATE_WAITING) {
-                        // enable take-off pin polling and init period
+                        // enable take-off edge detection
                         tkf.is_in_waiting_state = true;
-                        tkf.period = TIME_get() + TKF_PERIOD;
+                        tkf_acc_reset();
+                        tkf_edge_enable(true);
                 } else {
                         tkf.is_in_waiting_state = false;
+                        tkf_edge_enable(false);
                 }
                 break;
 
@@ -93,40 +339,72 @@ static PT_THREAD( tkf_thread_com(pt_t* pt) )
 
 static PT_THREAD( tkf_thread_dbnc(pt_t* pt) )
 {
+        u8 ev;
+
         PT_BEGIN(pt);
 
-        PT_WAIT_UNTIL(pt, TIME_get() > tkf.period);
-        tkf.period += TKF_PERIOD;
-
-        // read take-off pin (0 before take-off, 1 after)
-        u8 tk_off = TKOFF_PIN & TKOFF_PARA;
-//        if (tk_off)
-//                PORTD |= _BV(PD7);
-//        else
-//                PORTD &= ~_BV(PD7);
-
-        // debouncing
-        tkf.dbnc += tk_off ? 1 : -1;
-        if (tkf.dbnc < TKF_THRES_LO)
-                tkf.dbnc = TKF_THRES_LO;
-
-        // check if take-off is effective
-        if (tkf.dbnc > TKF_THRES_HI) {
-                tkf.out_fr.dest = DPT_SELF_ADDR;
-                //tkf.out_fr.orig = DPT_SELF_ADDR;
-                //tkf.out_fr.t_id = ?;
-                tkf.out_fr.cmde = FR_TAKE_OFF;
-
-                // send it throught the dispatcher
-                dpt_lock(&tkf.interf);
+        // forget a sampling of a previous filtering
+        tmb_alarm_cancel(&tkf.alarm);
+        while (OK == RING_get(&tkf.ev, &ev))
+                ;
 
-                // some retry may be necessary
-                PT_WAIT_UNTIL(pt, OK == dpt_tx(&tkf.interf, &tkf.out_fr));
+        // wait for a rising edge on the take-off pin or a long acceleration
+        PT_WAIT_UNTIL(pt, tkf.edge || (tkf.acc_alone_nb && tkf.acc_nb >= tkf.acc_alone_nb));
 
-                // release the dispatcher
-                dpt_unlock(&tkf.interf);
+        if (tkf.edge) {
+                ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                        tkf.edge_fr = tkf.edge_time;
+                }
+                tkf.sample = tkf.edge_fr;
+
+                // the pin shall stay high during the whole debounce window
+                do {
+                        tkf.sample += tkf.latency * TMB_1_MSEC;
+                        tmb_alarm_set(&tkf.alarm, tkf.sample);
+                        PT_WAIT_UNTIL(pt, OK == RING_get(&tkf.ev, &ev));
+
+                        // a falling edge or a low level means a glitch
+                        if (!tkf.edge || !(TKOFF_PIN & TKOFF_PARA)) {
+                                PT_RESTART(pt);
+                        }
+                } while (tkf.sample - tkf.edge_fr < tkf.window * TMB_1_MSEC);
+
+                // then the acceleration shall confirm the pin
+                PT_WAIT_UNTIL(pt, tkf_acc_confirm() || !tkf.edge || !(TKOFF_PIN & TKOFF_PARA));
+                if (!tkf.edge || !(TKOFF_PIN & TKOFF_PARA)) {
+                        PT_RESTART(pt);
+                }
+
+                // the take-off is when both are seen
+                tkf.take_off_time = tkf.edge_fr;
+                if (tkf.acc_nb >= tkf.acc_fused_nb && (s32)(tkf.acc_start - tkf.edge_fr) > 0)
+                        tkf.take_off_time = tkf.acc_start;
+        } else {
+                // the jumper is stuck
+                tkf.take_off_time = tkf.acc_start;
         }
 
+        // take-off is effective, the frame carries its time stamp
+        PT_WAIT_UNTIL(pt, OK == pol_alloc(&tkf.out_hd, POL_HIGH));
+        frame_set_4(pol_frame(tkf.out_hd), DPT_SELF_ADDR, DPT_SELF_ADDR, FR_TAKE_OFF, 0,
+                        tkf.take_off_time >> 24, tkf.take_off_time >> 16, tkf.take_off_time >> 8, tkf.take_off_time >> 0);
+
+        // send it throught the dispatcher
+        tkf.sending = true;
+        dpt_lock(&tkf.interf);
+
+        // some retry may be necessary
+        PT_WAIT_UNTIL(pt, OK == prf_try(PRF_Q_TKF_DPT, rte_tx(&tkf.interf, pol_frame(tkf.out_hd))));
+
+        // release the dispatcher
+        dpt_unlock(&tkf.interf);
+        tkf.sending = false;
+        pol_free(tkf.out_hd);
+
+        // only one take-off per edge
+        tkf.edge = false;
+        tkf.acc_nb = 0;
+
         PT_RESTART(pt);
 
         PT_END(pt);
@@ -142,13 +420,25 @@ void tkf_init(void)
         FIFO_init(&tkf.in_fifo, &tkf.in_buf, IN_FIFO_SIZE, sizeof(frame_t));
 
         tkf.interf.channel = 8;
-        tkf.interf.cmde_mask = _CM(FR_TAKE_OFF) | _CM(FR_STATE);
+        // the take-off frame is not registered, the dispatcher would only deliver our own one back
+        tkf.interf.cmde_mask = _CM(FR_TAKE_OFF_THRES) | _CM(FR_STATE);
         tkf.interf.queue = &tkf.in_fifo;
-        dpt_register(&tkf.interf);
+        rte_register(&tkf.interf);
 
         tkf.is_in_waiting_state = false;
-        tkf.dbnc = TKF_THRES_LO;
-        tkf.period = 0;
+        tkf.edge = false;
+        tkf.window = TKF_WINDOW;
+        tkf.latency = TKF_LATENCY;
+        tkf.acc_thres = TKF_ACC_THRES;
+        tkf.acc_fused = TKF_ACC_FUSED;
+        tkf.acc_alone = TKF_ACC_ALONE;
+        tkf_acc_thres();
+        tkf_acc_reset();
+        tkf.sending = false;
+
+        // the sampling times are posted by the timer2 interrupt
+        RING_init(&tkf.ev, tkf.ev_buf, EV_RING_SIZE);
+        tmb_alarm_init(&tkf.alarm, &tkf.ev, TKF_EV_SAMPLE);
 
         PT_INIT(&tkf.pt_com);
         PT_INIT(&tkf.pt_dbnc);
@@ -160,13 +450,27 @@ void tkf_init(void)
         // PD5 is the pull-up
         DDRD |= _BV(PD5);
         PORTD |= _BV(PD5);
+
+        // the capture interrupt is masked until the waiting state
+        // the noise canceler filters the pin on 4 cpu cycles
+        TIMSK1 &= ~_BV(ICIE1);
+        TCCR1B |= _BV(ICNC1);
+        tmb_tmr1_register(TMR1_CAPT, tkf_capture, NULL);
 }
 
 
-void tkf_run(void)
+u8 tkf_run(void)
 {
+        prf_queue(PRF_Q_TKF_IN, FIFO_full(&tkf.in_fifo));
+        prf_queue(PRF_Q_TKF_EV, RING_count(&tkf.ev));
+
         (void)PT_SCHEDULE(tkf_thread_com(&tkf.pt_com));
-        // enable take-off pin polling only in waiting state
-        if (tkf.is_in_waiting_state)
+        // enable take-off filtering only in waiting state
+        if (tkf.is_in_waiting_state) {
+                tkf_acc_check();
                 (void)PT_SCHEDULE(tkf_thread_dbnc(&tkf.pt_dbnc));
+        }
+
+        // the debounce window is paced by the sampling alarm
+        return FIFO_full(&tkf.in_fifo) || (tkf.is_in_waiting_state && RING_count(&tkf.ev)) || tkf.sending;
 }
@@ -1,10 +1,13 @@
 #ifndef __TK_OFF_H__
 # define __TK_OFF_H__
 
+#include "type_def.h"
+
 
 // take-off detection
 extern void tkf_init(void);
 
-extern void tkf_run(void);
+// return non-zero while some work is pending
+extern u8 tkf_run(void);
 
 #endif	// __TK_OFF_H__